@@ -1,13 +1,24 @@
 #include "types.h"
 #include "stat.h"
+#include "param.h"
+#include "schedstat.h"
 #include "user.h"
 
 int main(int argc, char* argv[])
 {
+    if(argc != 5)
+    {
+        printf(2, "usage: BJF_P pid priority_ratio arrivaltime_ratio execcycle_ratio\n");
+        exit();
+    }
     int pid = atoi(argv[1]);
     int priority_ratio = atoi(argv[2]);
     int arrivaltime_ratio = atoi(argv[3]);
     int execcycle_ratio = atoi(argv[4]);
-    BJF_parameter_process(pid, priority_ratio, arrivaltime_ratio, execcycle_ratio);
+    int r = BJF_parameter_process(pid, priority_ratio, arrivaltime_ratio, execcycle_ratio);
+    if(r == ESCHED_PID)
+        printf(2, "BJF_P: no process with pid %d\n", pid);
+    else if(r == ESCHED_ARG)
+        printf(2, "BJF_P: ratios must not be negative\n");
     exit();
-}
\ No newline at end of file
+}
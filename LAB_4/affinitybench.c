@@ -0,0 +1,62 @@
+// CPU affinity benchmark.
+// Usage: affinitybench [procs] [ticks]
+// Runs CPU-bound processes for a while, first free to run anywhere
+// and then each pinned to one cpu, and reports how often they were
+// moved from one cpu to another.  Run it with "make qemu CPUS=2"
+// or more; with one cpu nothing can migrate.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXPROCS 32
+
+void
+run(int nproc, int duration, int ncpu, int pin)
+{
+  int pids[MAXPROCS];
+  struct procstat ps;
+  uint nmigrate = 0, nrun = 0;
+  int i;
+
+  for(i = 0; i < nproc; i++){
+    if((pids[i] = fork()) == 0){
+      if(pin)
+        set_affinity(0, 1 << (i % ncpu));
+      burn();
+    }
+  }
+  sleep(duration);
+  for(i = 0; i < nproc; i++){
+    if(pids[i] > 0 && getprocstat(pids[i], &ps) == 0){
+      nmigrate += ps.nmigrate;
+      nrun += ps.nrun;
+    }
+  }
+  killwait(pids, nproc);
+
+  printf(1, "%s: %d runs, %d migrations\n",
+         pin ? "pinned  " : "unpinned", nrun, nmigrate);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  int nproc, duration;
+
+  getschedstat(&st);
+  nproc = argnum(argc, argv, 1, 2 * st.ncpu + 1);
+  duration = argnum(argc, argv, 2, 300);
+  if(nproc < 1 || nproc > MAXPROCS || duration < 1){
+    printf(2, "usage: affinitybench [procs 1-%d] [ticks]\n", MAXPROCS);
+    exit();
+  }
+
+  printf(1, "cpus %d procs %d ticks %d\n", st.ncpu, nproc, duration);
+  run(nproc, duration, st.ncpu, 0);
+  run(nproc, duration, st.ncpu, 1);
+  exit();
+}
@@ -0,0 +1,79 @@
+// Load balancing benchmark.
+// Usage: balancebench [procs] [ticks]
+// Forks CPU-bound processes, which all start out queued on the
+// cpu that forked them, and runs them for a while first with load
+// balancing off and then on.  Reports each cpu's load and busy
+// time, the processes moved, and the least and most cpu time any
+// one process got.  Run it with "make qemu CPUS=4" or more.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXPROCS 32
+
+void
+run(int nproc, int duration, int interval)
+{
+  int pids[MAXPROCS];
+  struct schedstat st0, st1;
+  struct procstat ps;
+  struct cpustat *c0, *c1;
+  uint nmigrate = 0, lo = ~0, hi = 0, elapsed;
+  int i, old;
+
+  old = set_balance(interval, -1);
+  getschedstat(&st0);
+  for(i = 0; i < nproc; i++)
+    pids[i] = hog();
+  sleep(duration);
+  getschedstat(&st1);
+  for(i = 0; i < nproc; i++){
+    if(pids[i] > 0 && getprocstat(pids[i], &ps) == 0){
+      nmigrate += ps.nmigrate;
+      if(ps.nticks < lo)
+        lo = ps.nticks;
+      if(ps.nticks > hi)
+        hi = ps.nticks;
+    }
+  }
+  killwait(pids, nproc);
+  set_balance(old, -1);
+
+  printf(1, "balancing %s\n", interval ? "on" : "off");
+  elapsed = st1.ticks - st0.ticks;
+  for(i = 0; i < st1.ncpu; i++){
+    c0 = &st0.cpu[i];
+    c1 = &st1.cpu[i];
+    printf(1, "  cpu%d: load %d.%d%d busy %d%% pulled %d stole %d hot %d\n", i,
+           c1->load / 100, c1->load / 10 % 10, c1->load % 10,
+           elapsed ? 100 - 100 * (c1->idleticks - c0->idleticks) / elapsed : 0,
+           c1->npull - c0->npull, c1->nsteal - c0->nsteal,
+           c1->nhot - c0->nhot);
+  }
+  printf(1, "  %d migrations, ticks per process %d to %d\n",
+         nmigrate, lo, hi);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  int nproc, duration;
+
+  getschedstat(&st);
+  nproc = argnum(argc, argv, 1, 3 * st.ncpu);
+  duration = argnum(argc, argv, 2, 300);
+  if(nproc < 1 || nproc > MAXPROCS || duration < 1){
+    printf(2, "usage: balancebench [procs 1-%d] [ticks]\n", MAXPROCS);
+    exit();
+  }
+
+  printf(1, "cpus %d procs %d ticks %d hot %d\n",
+         st.ncpu, nproc, duration, st.hotticks);
+  run(nproc, duration, 0);
+  run(nproc, duration, st.balanceticks ? st.balanceticks : 4);
+  exit();
+}
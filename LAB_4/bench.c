@@ -0,0 +1,56 @@
+// Helpers shared by the benchmark programs.
+
+#include "types.h"
+#include "param.h"
+#include "user.h"
+
+// Spin until killed.
+void
+burn(void)
+{
+  volatile uint x = 0;
+
+  for(;;)
+    x++;
+}
+
+// Fork a child that burns cpu until killed.  Returns its pid.
+int
+hog(void)
+{
+  int pid;
+
+  if((pid = fork()) == 0)
+    burn();
+  return pid;
+}
+
+// Kill the n processes in pids, skipping failed forks, and
+// wait for as many children to exit.
+void
+killwait(int *pids, int n)
+{
+  int i, k = 0;
+
+  for(i = 0; i < n; i++)
+    if(pids[i] > 0 && kill(pids[i]) == 0)
+      k++;
+  for(i = 0; i < k; i++)
+    wait();
+}
+
+// argv[i] as a number, or def if there are fewer arguments.
+int
+argnum(int argc, char *argv[], int i, int def)
+{
+  return argc > i ? atoi(argv[i]) : def;
+}
+
+// n events in the given ticks, per second.  Multiplies by HZ
+// only the remainder, so large counts cannot overflow, and there
+// is no 64-bit divide in user space.
+uint
+persec(uint n, uint ticks)
+{
+  return n / ticks * HZ + n % ticks * HZ / ticks;
+}
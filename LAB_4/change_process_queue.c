@@ -0,0 +1,22 @@
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 3)
+    {
+        printf(2, "usage: change_process_queue pid queue\n");
+        exit();
+    }
+    int pid = atoi(argv[1]);
+    int dest_queue = atoi(argv[2]);
+    int r = change_process_queue(pid, dest_queue);
+    if(r == ESCHED_PID)
+        printf(2, "change_process_queue: no process with pid %d\n", pid);
+    else if(r == ESCHED_ARG)
+        printf(2, "change_process_queue: queue must be 1 to %d\n", NLEVEL);
+    exit();
+}
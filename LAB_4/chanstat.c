@@ -0,0 +1,45 @@
+// Print the kernel's wait channel statistics.
+// Usage: chanstat [n]
+// Lists the n channels (default 10) with the most spurious
+// wakeups, i.e. processes that were woken and went straight
+// back to sleep on the same channel.  Find a channel's name
+// by looking up its address in kernel.sym.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXCHAN 256
+
+struct chanstat st[MAXCHAN];
+
+int
+main(int argc, char *argv[])
+{
+  struct chanstat t;
+  int n, top = 10;
+  int i, j;
+
+  if(argc > 1)
+    top = atoi(argv[1]);
+  if((n = getchanstat(st, MAXCHAN)) < 0){
+    printf(2, "chanstat: getchanstat failed\n");
+    exit();
+  }
+
+  // Insertion sort, most spurious wakeups first.
+  for(i = 1; i < n; i++){
+    t = st[i];
+    for(j = i; j > 0 && st[j-1].nspurious < t.nspurious; j--)
+      st[j] = st[j-1];
+    st[j] = t;
+  }
+
+  printf(1, "chan        wakeups   woken     spurious\n");
+  for(i = 0; i < n && i < top; i++)
+    printf(1, "0x%x  %d  %d  %d\n", st[i].chan,
+           st[i].nwakeup, st[i].nwoken, st[i].nspurious);
+  exit();
+}
@@ -1,14 +1,22 @@
 struct buf;
+struct chanstat;
 struct context;
 struct file;
 struct inode;
+struct kcache;
+struct lockclass;
+struct lockstat;
+struct lockstress;
 struct pipe;
+struct procstat;
 struct proc;
 struct rtcdate;
+struct schedstat;
 struct spinlock;
 struct sleeplock;
 struct stat;
 struct superblock;
+struct vm;
 
 // bio.c
 void            binit(void);
@@ -69,6 +77,9 @@ char*           kalloc(void);
 void            kfree(char*);
 void            kinit1(void*, void*);
 void            kinit2(void*, void*);
+struct kcache*  kcache_create(char*, int);
+void*           kcache_alloc(struct kcache*);
+void            kcache_free(struct kcache*, void*);
 
 // kbd.c
 void            kbdintr(void);
@@ -80,6 +91,7 @@ extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
 void            lapicstartap(uchar, uint);
+void            lapicipi(int, int);
 void            microdelay(int);
 
 // log.c
@@ -126,12 +138,30 @@ int             get_parent_pid(void);
 int             get_callers(int);
 int             change_process_queue(int, int);
 int             lottery_ticket(int, int);
-void            BJF_parameter_process(int, int, int, int);
-void            BJF_parameter_kernel(int, int, int);
+int             BJF_parameter_process(int, int, int, int);
+int             BJF_parameter_kernel(int, int, int);
 void            print_information(void);
-int             sem_init(int, int);
-int             sem_acquire(int);
-int             sem_release(int);
+int             getschedstat(struct schedstat*);
+int             getchanstat(struct chanstat*, int);
+void            lottery_seed(uint);
+int             set_lottery_mode(int);
+int             set_aging(int);
+void            sched_tick(void);
+int             sleep_ticks(int);
+void            expire_sleepers(uint);
+int             set_maxproc(int);
+int             set_quantum(int, int);
+int             getprocstat(int, struct procstat*);
+int             set_affinity(int, int);
+int             set_balance(int, int);
+int             set_nice(int, int);
+int             set_realtime(int, int, int, int);
+int             yield_to(int);
+struct vm*      vm_alloc(void);
+void            vm_put(struct vm*, pde_t*);
+void            setvm(struct vm*, pde_t*, uint);
+int             clone(uint, uint, uint);
+int             join(uint*);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -145,6 +175,28 @@ void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
 
+// futex.c
+void            futexinit(void);
+int             futex(uint, int, int);
+
+// lockprof.c
+struct lockclass* lockclass(char*, int);
+void            lockprof_acquired(struct lockclass*, int, uint, int);
+void            lockprof_released(struct lockclass*, int, uint);
+int             getlockstat(struct lockstat*, int, int);
+
+// lockstress.c
+void            lockstressinit(void);
+int             lockstress(int, uint, struct lockstress*);
+
+// sem.c
+void            seminit(void);
+int             sem_init(int);
+int             sem_free(int);
+int             sem_acquire(int);
+int             sem_tryacquire(int);
+int             sem_release(int);
+
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
 void            releasesleep(struct sleeplock*);
@@ -0,0 +1,138 @@
+// Real time scheduling benchmark.
+// Usage: edfbench [hogs] [ticks]
+// Runs three periodic tasks together with CPU-bound hogs, all on
+// cpu 0, first at level 2 with the hogs and then with the tasks
+// reserved at level 0.  Each task releases a job every period and
+// works for one tick less than its runtime; a job is late if it
+// is not done within its deadline.  Also checks that a reservation
+// that would overcommit cpu 0 is turned down.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXHOGS 16
+
+struct task {
+  int period, runtime, deadline;
+} tasks[] = {
+  { 10, 2, 10 },
+  { 20, 5, 15 },
+  { 40, 8, 30 },
+};
+#define NTASK (sizeof(tasks)/sizeof(tasks[0]))
+
+struct result {
+  uint njob;      // Jobs done
+  uint nlate;     // Those done after their deadline
+  struct procstat ps;
+};
+
+uint
+cputicks(void)
+{
+  struct procstat ps;
+
+  getprocstat(0, &ps);
+  return ps.nticks;
+}
+
+void
+periodic(struct task *t, int rt, int fd, uint end)
+{
+  struct result r;
+  uint release, now, n0;
+
+  memset(&r, 0, sizeof(r));
+  if(rt && set_realtime(0, t->period, t->runtime, t->deadline) < 0){
+    printf(2, "edfbench: reservation %d/%d/%d refused\n",
+           t->period, t->runtime, t->deadline);
+    exit();
+  }
+  for(release = uptime(); release + t->period <= end; release += t->period){
+    if((now = uptime()) < release)
+      sleep(release - now);
+    n0 = cputicks();
+    while(cputicks() - n0 < t->runtime - 1)
+      ;
+    r.njob++;
+    if(uptime() > release + t->deadline)
+      r.nlate++;
+  }
+  getprocstat(0, &r.ps);
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+void
+run(int nhog, int duration, int rt)
+{
+  int pids[MAXHOGS], fd[2], i, n, old, ret;
+  struct result r[NTASK];
+  uint end;
+
+  if(pipe(fd) < 0){
+    printf(2, "edfbench: pipe failed\n");
+    exit();
+  }
+  old = set_affinity(0, 1);
+  for(i = 0; i < nhog; i++)
+    pids[i] = hog();
+  end = uptime() + duration;
+  for(i = 0; i < NTASK; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      periodic(&tasks[i], rt, fd[1], end);
+    }
+  }
+  close(fd[1]);
+
+  printf(1, "%s\n", rt ? "reserved at level 0" : "at level 2");
+  if(rt){
+    sleep(2);
+    ret = set_realtime(0, 10, 3, 10);
+    if(ret == 0)
+      set_realtime(0, 0, 0, 0);
+    printf(1, "  another 3/10: %s\n", ret == ESCHED_BUSY ? "refused" : "admitted");
+  }
+  set_affinity(0, old);
+
+  for(n = 0; n < NTASK; n++)
+    if(read(fd[0], &r[n], sizeof(r[n])) != sizeof(r[n]))
+      break;
+  close(fd[0]);
+  killwait(pids, nhog);
+  for(i = 0; i < NTASK; i++)
+    wait();
+
+  for(i = 0; i < n; i++){
+    printf(1, "  pid %d: %d jobs, %d late", r[i].ps.pid, r[i].njob, r[i].nlate);
+    if(rt)
+      printf(1, " (kernel: %d jobs, %d missed, %d overran)",
+             r[i].ps.njob, r[i].ps.nmiss, r[i].ps.noverrun);
+    printf(1, "\n");
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nhog, duration, i;
+
+  nhog = argnum(argc, argv, 1, 4);
+  duration = argnum(argc, argv, 2, 500);
+  if(nhog < 0 || nhog > MAXHOGS || duration < 1){
+    printf(2, "usage: edfbench [hogs 0-%d] [ticks]\n", MAXHOGS);
+    exit();
+  }
+
+  printf(1, "hogs %d ticks %d, tasks", nhog, duration);
+  for(i = 0; i < NTASK; i++)
+    printf(1, " %d/%d/%d", tasks[i].runtime, tasks[i].deadline, tasks[i].period);
+  printf(1, " (runtime/deadline/period)\n");
+  run(nhog, duration, 0);
+  run(nhog, duration, 1);
+  exit();
+}
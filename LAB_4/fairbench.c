@@ -0,0 +1,120 @@
+// Fair scheduling benchmark.
+// Usage: fairbench [hogs] [sleepers] [ticks]
+// Runs CPU-bound hogs together with sleepers that wake every tick
+// to do a little work, all on cpu 0, first at level 2 (lottery)
+// and then at level 4 (completely fair).  Reports the least and
+// most cpu time any hog got, and how many ticks late the sleepers
+// ran after their sleep ended.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXPROCS 16
+
+struct result {
+  uint nwake;     // Sleeps done
+  uint late;      // Total ticks late over all of them
+  uint maxlate;   // Most ticks late at once
+};
+
+void
+sleeper(int fd, int end)
+{
+  struct result r;
+  volatile uint x;
+  uint t0, late;
+
+  memset(&r, 0, sizeof(r));
+  while(uptime() < end){
+    t0 = uptime();
+    sleep(1);
+    late = uptime() - t0 - 1;
+    r.nwake++;
+    r.late += late;
+    if(late > r.maxlate)
+      r.maxlate = late;
+    for(x = 0; x < 10000; x++)
+      ;
+  }
+  write(fd, &r, sizeof(r));
+  exit();
+}
+
+void
+run(int level, int nhog, int nsleep, int duration)
+{
+  int pids[MAXPROCS], fd[2], i, old, end;
+  struct procstat ps;
+  struct result r, sum;
+  uint lo = ~0, hi = 0;
+
+  if(pipe(fd) < 0){
+    printf(2, "fairbench: pipe failed\n");
+    exit();
+  }
+  memset(&sum, 0, sizeof(sum));
+  old = set_affinity(0, 1);
+  end = uptime() + duration;
+  for(i = 0; i < nhog + nsleep; i++){
+    if((pids[i] = fork()) == 0){
+      close(fd[0]);
+      change_process_queue(getpid(), level);
+      if(i < nhog)
+        burn();
+      sleeper(fd[1], end);
+    }
+  }
+  set_affinity(0, old);
+  close(fd[1]);
+
+  sleep(duration);
+  for(i = 0; i < nhog; i++){
+    if(pids[i] > 0 && getprocstat(pids[i], &ps) == 0){
+      if(ps.nticks < lo)
+        lo = ps.nticks;
+      if(ps.nticks > hi)
+        hi = ps.nticks;
+    }
+  }
+  killwait(pids, nhog);
+  while(read(fd[0], &r, sizeof(r)) == sizeof(r)){
+    sum.nwake += r.nwake;
+    sum.late += r.late;
+    if(r.maxlate > sum.maxlate)
+      sum.maxlate = r.maxlate;
+  }
+  close(fd[0]);
+  for(i = 0; i < nsleep; i++)
+    wait();
+
+  printf(1, "level %d (%s)\n", level, level == 4 ? "fair" : "lottery");
+  if(nhog > 0)
+    printf(1, "  hog ticks %d to %d\n", lo, hi);
+  if(sum.nwake > 0)
+    printf(1, "  %d wakeups, %d.%d%d ticks late on average, %d at most\n",
+           sum.nwake, sum.late / sum.nwake, sum.late * 10 / sum.nwake % 10,
+           sum.late * 100 / sum.nwake % 10, sum.maxlate);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nhog, nsleep, duration;
+
+  nhog = argnum(argc, argv, 1, 4);
+  nsleep = argnum(argc, argv, 2, 2);
+  duration = argnum(argc, argv, 3, 500);
+  if(nhog + nsleep < 1 || nhog + nsleep > MAXPROCS || duration < 1){
+    printf(2, "usage: fairbench [hogs] [sleepers] [ticks], at most %d processes\n",
+           MAXPROCS);
+    exit();
+  }
+
+  printf(1, "hogs %d sleepers %d ticks %d\n", nhog, nsleep, duration);
+  run(2, nhog, nsleep, duration);
+  run(4, nhog, nsleep, duration);
+  exit();
+}
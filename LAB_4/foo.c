@@ -1,5 +1,7 @@
 #include "types.h"
 #include "stat.h"
+#include "param.h"
+#include "schedstat.h"
 #include "user.h"
 #include "fcntl.h"
 
@@ -7,6 +9,7 @@ int main(int argc, char *argv[])
 {
    int pid;
     float x = 1000000;
+    struct procstat ps;
     for (int i = 0 ; i < 5 ; i++)
     {
         pid = fork();
@@ -16,10 +19,15 @@ int main(int argc, char *argv[])
             {
                 x = x / 1.001;
             }
+            // Fewer runs for the same ticks of work means fewer
+            // context switches; compare after set_quantum.
+            getprocstat(0, &ps);
+            printf(1, "foo %d: level %d, %d ticks of work in %d runs\n",
+                   ps.pid, ps.level, ps.nticks, ps.nrun);
             exit();
         }
     }
     for (int i = 0; i < 5; i++)
       wait();
-    return 0;
+    exit();
 }
\ No newline at end of file
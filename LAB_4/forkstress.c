@@ -0,0 +1,78 @@
+// fork/exit/wait stress benchmark.
+// Usage: forkstress [workers] [forks]
+// Starts one worker per cpu (or as many as asked), each of which
+// forks children that exit at once and waits for them, as fast
+// as it can.  Every fork, exit and wait goes through the process
+// table's locks, so the rate shows how well they scale with
+// "make qemu CPUS=1" up to "CPUS=8".  Also reports how often a
+// kernel stack came from the per-cpu cache.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXWORKERS 16
+
+void
+worker(int n)
+{
+  int i, pid;
+
+  for(i = 0; i < n; i++){
+    pid = fork();
+    if(pid < 0){
+      printf(2, "forkstress: fork failed\n");
+      exit();
+    }
+    if(pid == 0)
+      exit();
+    if(wait() != pid){
+      printf(2, "forkstress: wait returned the wrong child\n");
+      exit();
+    }
+  }
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int workers, forks;
+  struct schedstat st, st1;
+  uint t0, elapsed, hit, miss;
+  int i;
+
+  getschedstat(&st);
+  workers = argnum(argc, argv, 1, st.ncpu);
+  forks = argnum(argc, argv, 2, 1000);
+  if(workers < 1 || workers > MAXWORKERS || forks < 1){
+    printf(2, "usage: forkstress [workers 1-%d] [forks]\n", MAXWORKERS);
+    exit();
+  }
+
+  t0 = uptime();
+  for(i = 0; i < workers; i++){
+    if(fork() == 0)
+      worker(forks);
+  }
+  for(i = 0; i < workers; i++)
+    wait();
+  elapsed = uptime() - t0;
+  if(elapsed == 0)
+    elapsed = 1;
+  getschedstat(&st1);
+  hit = miss = 0;
+  for(i = 0; i < st1.ncpu; i++){
+    hit += st1.cpu[i].kstackhit - st.cpu[i].kstackhit;
+    miss += st1.cpu[i].kstackmiss - st.cpu[i].kstackmiss;
+  }
+
+  printf(1, "cpus %d workers %d: %d forks in %d ticks, %d forks/sec\n",
+         st.ncpu, workers, workers * forks, elapsed,
+         persec(workers * forks, elapsed));
+  printf(1, "kernel stack cache: %d hits, %d misses, %d%% hit rate\n",
+         hit, miss, hit + miss ? hit * 100 / (hit + miss) : 0);
+  exit();
+}
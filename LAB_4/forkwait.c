@@ -0,0 +1,53 @@
+// Batch fork/wait benchmark.
+// Usage: forkwait [children] [rounds]
+// Each round forks a batch of children that exit at once and then
+// waits for the whole batch, the way a shell script or forktest
+// does.  The cost of wait() and exit() grows with the number of
+// processes they look at, so try batches of different sizes.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+int
+main(int argc, char *argv[])
+{
+  int children, rounds;
+  int i, r, n, pid;
+  uint t0, elapsed;
+
+  children = argnum(argc, argv, 1, 50);
+  rounds = argnum(argc, argv, 2, 100);
+  if(children < 1 || rounds < 1){
+    printf(2, "usage: forkwait [children] [rounds]\n");
+    exit();
+  }
+
+  n = 0;
+  t0 = uptime();
+  for(r = 0; r < rounds; r++){
+    for(i = 0; i < children; i++){
+      if((pid = fork()) < 0)
+        break;
+      if(pid == 0)
+        exit();
+    }
+    if(i == 0){
+      printf(2, "forkwait: fork failed\n");
+      exit();
+    }
+    n += i;
+    while(i-- > 0)
+      if(wait() < 0){
+        printf(2, "forkwait: wait failed\n");
+        exit();
+      }
+  }
+  elapsed = uptime() - t0;
+  if(elapsed == 0)
+    elapsed = 1;
+
+  printf(1, "batches of %d: %d forks and waits in %d ticks, %d/sec\n",
+         n / rounds, n, elapsed, persec(n, elapsed));
+  exit();
+}
@@ -0,0 +1,163 @@
+// Futexes.
+//
+// futex(addr, FUTEX_WAIT, val) sleeps as long as the word at user
+// address addr holds val, and futex(addr, FUTEX_WAKE, n) wakes up
+// to n of the processes sleeping on addr.  User code keeps its
+// locks in such words and calls futex() only to sleep while one is
+// taken and to wake a sleeper when it is given back.
+//
+// A futex is known by the kernel address of its word, found through
+// the page table, so processes that share the page share it.
+// Waiters hang in arrival order on one of NFUTEXQ hash queues, each
+// sleeping on its own channel, so a wake wakes exactly those it
+// counts.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "futex.h"
+
+#define FUTEXQ_SHIFT 6
+#define NFUTEXQ (1<<FUTEXQ_SHIFT)
+
+// Lives on the waiting process's kernel stack.
+struct futexwaiter {
+  char *key;
+  int woken;
+  struct futexwaiter *next;
+};
+
+struct futexq {
+  struct spinlock lock;
+  struct futexwaiter *head;
+  struct futexwaiter *tail;
+};
+
+static struct futexq futexq[NFUTEXQ];
+
+void
+futexinit(void)
+{
+  struct futexq *q;
+
+  for(q = futexq; q < futexq+NFUTEXQ; q++)
+    initlock(&q->lock, "futex");
+}
+
+static struct futexq*
+futexq_of(char *key)
+{
+  return &futexq[((uint)key * 0x9E3779B9) >> (32 - FUTEXQ_SHIFT)];
+}
+
+// Kernel address of the word at user address addr, or 0.
+static char*
+futex_key(uint addr)
+{
+  struct proc *p = myproc();
+  char *page;
+
+  if(addr % 4 != 0 || addr >= p->sz)
+    return 0;
+  if((page = uva2ka(p->pgdir, (char*)PGROUNDDOWN(addr))) == 0)
+    return 0;
+  return page + (addr & (PGSIZE-1));
+}
+
+// Take w, which gave up waiting, off q.
+static void
+futexq_remove(struct futexq *q, struct futexwaiter *w)
+{
+  struct futexwaiter *x, *prev = 0;
+
+  for(x = q->head; x != w; x = x->next)
+    prev = x;
+  if(prev)
+    prev->next = w->next;
+  else
+    q->head = w->next;
+  if(q->tail == w)
+    q->tail = prev;
+}
+
+// The word is read with the queue locked, and a waker locks
+// the queue after changing the word, so no wakeup is lost.
+static int
+futex_wait(char *key, int val)
+{
+  struct futexq *q = futexq_of(key);
+  struct futexwaiter w;
+
+  acquire(&q->lock);
+  if(*(volatile int*)key != val){
+    release(&q->lock);
+    return 0;
+  }
+  w.key = key;
+  w.woken = 0;
+  w.next = 0;
+  if(q->tail)
+    q->tail->next = &w;
+  else
+    q->head = &w;
+  q->tail = &w;
+  while(!w.woken && !myproc()->killed)
+    sleep(&w, &q->lock);
+  if(!w.woken){
+    futexq_remove(q, &w);
+    release(&q->lock);
+    return -1;
+  }
+  release(&q->lock);
+  return 0;
+}
+
+static int
+futex_wake(char *key, int n)
+{
+  struct futexq *q = futexq_of(key);
+  struct futexwaiter *w, *next, *prev = 0;
+  int woken = 0;
+
+  acquire(&q->lock);
+  for(w = q->head; w && woken < n; w = next){
+    next = w->next;
+    if(w->key != key){
+      prev = w;
+      continue;
+    }
+    if(prev)
+      prev->next = next;
+    else
+      q->head = next;
+    if(q->tail == w)
+      q->tail = prev;
+    w->woken = 1;
+    wakeup(w);
+    woken++;
+  }
+  release(&q->lock);
+  return woken;
+}
+
+// FUTEX_WAIT returns 0 when woken or if the word no longer held
+// val, FUTEX_WAKE the number of processes woken; both return -1
+// for a bad address or if the caller is killed.
+int
+futex(uint addr, int op, int val)
+{
+  char *key;
+
+  if((key = futex_key(addr)) == 0)
+    return -1;
+  switch(op){
+  case FUTEX_WAIT:
+    return futex_wait(key, val);
+  case FUTEX_WAKE:
+    return futex_wake(key, val);
+  }
+  return -1;
+}
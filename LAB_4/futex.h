@@ -0,0 +1,3 @@
+// Operations for futex().
+#define FUTEX_WAIT 0   // Sleep if *addr still holds val
+#define FUTEX_WAKE 1   // Wake up to val processes sleeping on addr
@@ -0,0 +1,75 @@
+// Futex mutex benchmark.
+// Usage: futexbench [ticks]
+// Counts uncontended lock/unlock pairs done in the given time with
+// a ulib mutex, which never enters the kernel when it is free, and
+// with a semaphore, which takes two system calls.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "user.h"
+
+#define BATCH 1024  // pairs between looks at the clock
+
+uint
+mutex_pairs(int duration)
+{
+  struct mutex m;
+  uint n = 0, end;
+  int i;
+
+  mutex_init(&m);
+  end = uptime() + duration;
+  while(uptime() < end){
+    for(i = 0; i < BATCH; i++){
+      mutex_lock(&m);
+      mutex_unlock(&m);
+    }
+    n += BATCH;
+  }
+  return n;
+}
+
+uint
+sem_pairs(int duration)
+{
+  uint n = 0, end;
+  int s, i;
+
+  if((s = sem_init(1)) < 0){
+    printf(2, "futexbench: sem_init failed\n");
+    exit();
+  }
+  end = uptime() + duration;
+  while(uptime() < end){
+    for(i = 0; i < BATCH; i++){
+      sem_acquire(s);
+      sem_release(s);
+    }
+    n += BATCH;
+  }
+  sem_free(s);
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int duration = 100;
+  uint m, s;
+
+  if(argc > 1)
+    duration = atoi(argv[1]);
+  if(duration < 1){
+    printf(2, "usage: futexbench [ticks]\n");
+    exit();
+  }
+
+  m = mutex_pairs(duration);
+  s = sem_pairs(duration);
+  printf(1, "mutex:     %d pairs/sec\n", persec(m, duration));
+  printf(1, "semaphore: %d pairs/sec\n", persec(s, duration));
+  if(s > 0)
+    printf(1, "mutex is %d times faster\n", m / s);
+  exit();
+}
@@ -94,3 +94,86 @@ kalloc(void)
   return (char*)r;
 }
 
+
+//PAGEBREAK!
+// Object caches.
+// A kcache hands out objects of one size carved from whole pages.
+// Freed objects go on the cache's own free list and the pages are
+// never given back to kfree(), so memory that once held an object
+// of some type always holds one: a stale pointer can still be
+// followed and the object checked under its own lock.
+
+#define NKCACHE 8
+
+struct kcache {
+  struct spinlock lock;
+  char *name;
+  int size;
+  struct run *freelist;
+  char *page;        // Page being carved up
+  int left;          // Bytes left in it
+  uint nobj;         // Objects in use
+  uint npage;        // Pages taken from kalloc()
+};
+
+static struct kcache kcaches[NKCACHE];
+static int nkcache;
+
+// Called during boot, before other cpus start.
+struct kcache*
+kcache_create(char *name, int size)
+{
+  struct kcache *kc;
+
+  if(size < sizeof(struct run))
+    size = sizeof(struct run);
+  size = (size + 3) & ~3;
+  if(size > PGSIZE || nkcache == NKCACHE)
+    panic("kcache_create");
+  kc = &kcaches[nkcache++];
+  initlock(&kc->lock, "kcache");
+  kc->name = name;
+  kc->size = size;
+  return kc;
+}
+
+// Return an object, uninitialized, or 0 if out of memory.
+void*
+kcache_alloc(struct kcache *kc)
+{
+  struct run *r;
+  char *obj;
+
+  acquire(&kc->lock);
+  if((r = kc->freelist) != 0){
+    kc->freelist = r->next;
+    obj = (char*)r;
+  } else {
+    if(kc->left < kc->size){
+      if((kc->page = kalloc()) == 0){
+        release(&kc->lock);
+        return 0;
+      }
+      kc->left = PGSIZE;
+      kc->npage++;
+    }
+    obj = kc->page;
+    kc->page += kc->size;
+    kc->left -= kc->size;
+  }
+  kc->nobj++;
+  release(&kc->lock);
+  return obj;
+}
+
+void
+kcache_free(struct kcache *kc, void *obj)
+{
+  struct run *r = (struct run*)obj;
+
+  acquire(&kc->lock);
+  r->next = kc->freelist;
+  kc->freelist = r;
+  kc->nobj--;
+  release(&kc->lock);
+}
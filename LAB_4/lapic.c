@@ -120,6 +120,19 @@ microdelay(int us)
 {
 }
 
+// Send interrupt vector to the cpu whose local APIC has ID apicid.
+// Interrupts must be off, so that nothing else uses ICR meanwhile.
+void
+lapicipi(int apicid, int vector)
+{
+  if(!lapic)
+    return;
+  lapicw(ICRHI, apicid<<24);
+  lapicw(ICRLO, FIXED | ASSERT | vector);
+  while(lapic[ICRLO] & DELIVS)
+    ;
+}
+
 #define CMOS_PORT    0x70
 #define CMOS_RETURN  0x71
 
@@ -0,0 +1,105 @@
+// Spinlock stress benchmark.
+// Usage: lockbench [nproc] [ticks]
+// nproc processes, spread over the cpus, take one kernel lock
+// over and over, first the ticket lock behind acquire() and then,
+// if the kernel was built with LOCKSTRESS_XCHG, the xchg
+// test-and-set lock it replaced.  Reports acquisitions per second,
+// the fewest and most any one process got, and the longest any of
+// them waited for the lock.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "lockstat.h"
+#include "user.h"
+
+#define MAXPROCS 32
+
+void
+stress(int kind, int rfd, int wfd)
+{
+  struct lockstress ls;
+  uint end;
+
+  if(read(rfd, &end, sizeof(end)) != sizeof(end))
+    exit();
+  if(lockstress(kind, end, &ls) < 0)
+    exit();
+  write(wfd, &ls, sizeof(ls));
+  exit();
+}
+
+void
+run(int nproc, int ncpu, int duration, int kind)
+{
+  int start[2], res[2], i, got = 0;
+  struct lockstress ls;
+  uint n = 0, lo = ~0, hi = 0, maxwait = 0, end;
+
+  if(pipe(start) < 0 || pipe(res) < 0){
+    printf(2, "lockbench: pipe failed\n");
+    exit();
+  }
+  for(i = 0; i < nproc; i++){
+    if(fork() == 0){
+      set_affinity(0, 1 << (i % ncpu));
+      close(start[1]);
+      close(res[0]);
+      stress(kind, start[0], res[1]);
+    }
+  }
+  close(start[0]);
+  close(res[1]);
+
+  // Let them all go at once.
+  end = uptime() + 1 + duration;
+  for(i = 0; i < nproc; i++)
+    write(start[1], &end, sizeof(end));
+  close(start[1]);
+
+  while(read(res[0], &ls, sizeof(ls)) == sizeof(ls)){
+    got++;
+    n += ls.nacquire;
+    if(ls.nacquire < lo)
+      lo = ls.nacquire;
+    if(ls.nacquire > hi)
+      hi = ls.nacquire;
+    if(ls.maxwait > maxwait)
+      maxwait = ls.maxwait;
+  }
+  close(res[0]);
+  for(i = 0; i < nproc; i++)
+    wait();
+
+  if(got == 0){
+    printf(1, "%s: not built into this kernel\n",
+           kind == LOCK_TICKET ? "ticket" : "xchg  ");
+    return;
+  }
+  printf(1, "%s: %d acquisitions/sec, %d to %d each, worst wait %d cycles\n",
+         kind == LOCK_TICKET ? "ticket" : "xchg  ", persec(n, duration),
+         lo, hi, maxwait);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct schedstat st;
+  int nproc, duration;
+
+  getschedstat(&st);
+  nproc = argnum(argc, argv, 1, st.ncpu);
+  duration = argnum(argc, argv, 2, 300);
+  if(nproc < 1 || nproc > MAXPROCS ||
+     duration < 1 || duration >= LOCKSTRESS_MAXTICKS){
+    printf(2, "usage: lockbench [nproc 1-%d] [ticks 1-%d]\n",
+           MAXPROCS, LOCKSTRESS_MAXTICKS - 1);
+    exit();
+  }
+
+  printf(1, "processes %d cpus %d ticks %d\n", nproc, st.ncpu, duration);
+  run(nproc, st.ncpu, duration, LOCK_TICKET);
+  run(nproc, st.ncpu, duration, LOCK_XCHG);
+  exit();
+}
@@ -0,0 +1,179 @@
+// Lock profiling.
+//
+// initlock() and initsleeplock() give each lock the class for its
+// kind and name, looked up once per name string, and acquire(),
+// release(), acquiresleep() and releasesleep() count into that
+// class's slot for the cpu they run on.  Each cpu only writes its
+// own row of slots, with interrupts off, so counting needs no lock
+// and no shared cache lines; getlockstat() adds the rows up.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "mmu.h"
+#include "lockstat.h"
+
+#define NAMELEN 16      // as in struct lockstat
+#define SITE_SHIFT 7
+#define NSITE (1<<SITE_SHIFT)
+
+struct lockclass {
+  char *name;
+  int kind;
+  int id;                  // Column in slot
+};
+
+struct lockslot {
+  uint nacquire;
+  uint ncontend;
+  uint64 wait;             // TSC cycles
+  uint maxhold;
+};
+
+static struct lockclass class[NLOCKSTAT];
+static int nclass;
+static struct lockslot slot[NCPU][NLOCKSTAT];
+
+// The class found for each name string passed to initlock() or
+// initsleeplock(), hashed by its address.  Names are string
+// constants, so each is looked up by name only once, and after
+// that an init finds its class here without taking a lock or
+// writing anything.  Entries are filled in once and never
+// change; name is set last, so a reader that sees it sees lc.
+static struct {
+  char *volatile name;
+  int kind;
+  struct lockclass *lc;
+} site[NSITE];
+
+// Guards class[], nclass and filling in site[].  Not a spinlock,
+// since initlock() runs before mycpu() can tell which cpu this is.
+static volatile uint classbusy;
+
+// The index of the site[] entry for name and kind, or of the empty
+// one where it would go, or -1 if the table is full.
+static int
+site_find(char *name, int kind)
+{
+  uint h = ((uint)name * 2654435761U) >> (32 - SITE_SHIFT);
+  int i, j;
+
+  for(i = 0; i < NSITE; i++){
+    j = (h + i) & (NSITE-1);
+    if(site[j].name == 0 || (site[j].name == name && site[j].kind == kind))
+      return j;
+  }
+  return -1;
+}
+
+// Return the class of locks with this kind and name, or 0
+// if there is no room for another.
+struct lockclass*
+lockclass(char *name, int kind)
+{
+  struct lockclass *lc;
+  uint eflags;
+  int i;
+
+  if(name == 0)
+    return 0;
+  if((i = site_find(name, kind)) >= 0 && site[i].name)
+    return site[i].lc;
+
+  // First time for this string: look it up by name.
+  eflags = readeflags();
+  cli();
+  while(xchg(&classbusy, 1) != 0)
+    pause();
+  if((i = site_find(name, kind)) >= 0 && site[i].name){
+    lc = site[i].lc;
+    goto out;
+  }
+  for(lc = class; lc < class+nclass; lc++)
+    if(lc->kind == kind && strncmp(lc->name, name, NAMELEN) == 0)
+      break;
+  if(lc == class+nclass){
+    if(nclass == NLOCKSTAT)
+      lc = 0;
+    else {
+      lc->name = name;
+      lc->kind = kind;
+      lc->id = nclass++;
+    }
+  }
+  if(i >= 0){
+    site[i].kind = kind;
+    site[i].lc = lc;
+    __sync_synchronize();
+    site[i].name = name;
+  }
+out:
+  xchg(&classbusy, 0);
+  if(eflags & FL_IF)
+    sti();
+  return lc;
+}
+
+// Called by cpu with interrupts off once it holds a lock
+// of class lc, after waiting wait cycles.
+void
+lockprof_acquired(struct lockclass *lc, int cpu, uint wait, int contended)
+{
+  struct lockslot *s = &slot[cpu][lc->id];
+
+  s->nacquire++;
+  if(contended)
+    s->ncontend++;
+  s->wait += wait;
+}
+
+// Called by cpu with interrupts off as it gives back a lock of
+// class lc that it has held for hold cycles.
+void
+lockprof_released(struct lockclass *lc, int cpu, uint hold)
+{
+  struct lockslot *s = &slot[cpu][lc->id];
+
+  if(hold > s->maxhold)
+    s->maxhold = hold;
+}
+
+// Copy out up to n classes, most time waited for first, and
+// if reset is set, start counting again from zero.  Counts
+// that other cpus make during a reset may be lost.
+int
+getlockstat(struct lockstat *st, int n, int reset)
+{
+  struct lockstat t;
+  struct lockslot *s;
+  uint64 cycles;
+  int m, i, j, cpu;
+
+  m = nclass;
+  for(i = 0; i < m; i++){
+    memset(&t, 0, sizeof(t));
+    safestrcpy(t.name, class[i].name, sizeof(t.name));
+    t.kind = class[i].kind;
+    cycles = 0;
+    for(cpu = 0; cpu < NCPU; cpu++){
+      s = &slot[cpu][i];
+      t.nacquire += s->nacquire;
+      t.ncontend += s->ncontend;
+      cycles += s->wait;
+      if(s->maxhold > t.maxhold)
+        t.maxhold = s->maxhold;
+    }
+    t.waitk = cycles >> 10;
+
+    // Insertion sort into st[0..n).
+    for(j = i < n ? i : n; j > 0 && st[j-1].waitk < t.waitk; j--)
+      if(j < n)
+        st[j] = st[j-1];
+    if(j < n)
+      st[j] = t;
+  }
+  if(reset)
+    memset(slot, 0, sizeof(slot));
+  return m < n ? m : n;
+}
@@ -0,0 +1,50 @@
+// Print the kernel's lock profile and start it again from zero.
+// Usage: lockstat [command [args]]
+// With a command, clears the counters, runs it and then prints
+// what it caused.  Locks with the same name are counted together;
+// the ones waited for longest come first.  Wait is in units of
+// 1024 TSC cycles and hold in cycles.
+
+#include "types.h"
+#include "stat.h"
+#include "lockstat.h"
+#include "user.h"
+
+#define MAXCLASS 64
+
+struct lockstat st[MAXCLASS];
+
+int
+main(int argc, char *argv[])
+{
+  int n, i, pid;
+
+  if(argc > 1){
+    getlockstat(st, 0, 1);
+    if((pid = fork()) < 0){
+      printf(2, "lockstat: fork failed\n");
+      exit();
+    }
+    if(pid == 0){
+      exec(argv[1], argv+1);
+      printf(2, "lockstat: exec %s failed\n", argv[1]);
+      exit();
+    }
+    wait();
+  }
+  if((n = getlockstat(st, MAXCLASS, 1)) < 0){
+    printf(2, "lockstat: getlockstat failed\n");
+    exit();
+  }
+
+  printf(1, "name  kind  acquired  contended  wait(k)  maxhold\n");
+  for(i = 0; i < n; i++){
+    if(st[i].nacquire == 0)
+      continue;
+    printf(1, "%s  %s  %d  %d  %d  %d\n", st[i].name,
+           st[i].kind == LOCKSTAT_SLEEP ? "sleep" : "spin ",
+           st[i].nacquire, st[i].ncontend,
+           st[i].waitk, st[i].maxhold);
+  }
+  exit();
+}
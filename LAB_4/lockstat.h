@@ -0,0 +1,31 @@
+// Lock kinds for lockstress().
+#define LOCK_TICKET 0   // struct spinlock, as acquire() takes it
+#define LOCK_XCHG   1   // The old test-and-set loop on xchg, only
+                        // in kernels built with LOCKSTRESS_XCHG
+
+#define LOCKSTRESS_MAXTICKS (60*HZ)  // Longest lockstress() run
+
+// Filled in by lockstress() for the calling process.
+struct lockstress {
+  uint nacquire;     // Times it took the lock
+  uint maxwait;      // Longest wait for it, in TSC cycles
+};
+
+// Kinds of lock in struct lockstat.
+#define LOCKSTAT_SPIN  0
+#define LOCKSTAT_SLEEP 1
+
+// Lock profile, filled in by getlockstat().  Locks are counted
+// together by kind and name, so every pipe's lock adds to "pipe".
+
+#define NLOCKSTAT 64    // Most kinds and names counted
+
+struct lockstat {
+  char name[16];
+  int kind;          // LOCKSTAT_SPIN or LOCKSTAT_SLEEP
+  uint nacquire;     // Acquisitions
+  uint ncontend;     // Those that found the lock held
+  uint waitk;        // Time spent spinning or sleeping for it,
+                     // in units of 1024 TSC cycles
+  uint maxhold;      // Longest it was held, in TSC cycles
+};
@@ -0,0 +1,92 @@
+// Lock stress test.
+//
+// Processes on several cpus call lockstress() at once to take one
+// shared lock over and over until a given tick, either a struct
+// spinlock or the xchg test-and-set lock that acquire() used to
+// spin on.  The xchg lock is only there to compare against, and
+// is built in only with make LOCKSTRESS_XCHG=1.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "lockstat.h"
+
+#define HOLD 50   // iterations of work done holding the lock
+
+static struct spinlock stresslock;
+static volatile uint counter;   // Bumped under the lock
+
+void
+lockstressinit(void)
+{
+  initlock(&stresslock, "stress");
+}
+
+#ifdef LOCKSTRESS_XCHG
+static volatile uint xchglock;
+
+static void
+xchg_acquire(void)
+{
+  pushcli();
+  while(xchg(&xchglock, 1) != 0)
+    ;
+  __sync_synchronize();
+}
+
+static void
+xchg_release(void)
+{
+  __sync_synchronize();
+  asm volatile("movl $0, %0" : "+m" (xchglock) : );
+  popcli();
+}
+#endif
+
+// Take the lock of the given kind until ticks reaches end, at
+// most LOCKSTRESS_MAXTICKS from now, or until killed, and report
+// on it in *ls.  Returns -1 for a kind not built in.
+int
+lockstress(int kind, uint end, struct lockstress *ls)
+{
+  uint t0, wait;
+  volatile int i;
+
+  if(kind != LOCK_TICKET){
+#ifdef LOCKSTRESS_XCHG
+    if(kind != LOCK_XCHG)
+#endif
+      return -1;
+  }
+  if((int)(end - ticks) > LOCKSTRESS_MAXTICKS)
+    return -1;
+  memset(ls, 0, sizeof(*ls));
+  while(ticks < end && !myproc()->killed){
+    t0 = rdtsc();
+#ifdef LOCKSTRESS_XCHG
+    if(kind == LOCK_XCHG)
+      xchg_acquire();
+    else
+#endif
+      acquire(&stresslock);
+    wait = rdtsc() - t0;
+    counter++;
+    for(i = 0; i < HOLD; i++)
+      ;
+#ifdef LOCKSTRESS_XCHG
+    if(kind == LOCK_XCHG)
+      xchg_release();
+    else
+#endif
+      release(&stresslock);
+
+    ls->nacquire++;
+    if(wait > ls->maxwait)
+      ls->maxwait = wait;
+  }
+  return 0;
+}
@@ -1,11 +1,22 @@
 #include "types.h"
 #include "stat.h"
+#include "param.h"
+#include "schedstat.h"
 #include "user.h"
 
 int main(int argc, char* argv[])
 {
+    if(argc != 3)
+    {
+        printf(2, "usage: lottery_ticket pid ticket\n");
+        exit();
+    }
     int pid = atoi(argv[1]);
     int ticket = atoi(argv[2]);
-    lottery_ticket(pid, ticket);
+    int r = lottery_ticket(pid, ticket);
+    if(r == ESCHED_PID)
+        printf(2, "lottery_ticket: no process with pid %d\n", pid);
+    else if(r == ESCHED_ARG)
+        printf(2, "lottery_ticket: ticket must be at least 1\n");
     exit();
-}
\ No newline at end of file
+}
@@ -0,0 +1,77 @@
+// Lottery fairness test.
+// Usage: lotteryfair [ticks]
+// Runs three CPU-bound level 2 processes holding 100, 200 and 300
+// tickets for the given number of ticks and checks that each got a
+// share of the loop iterations within TOLERANCE per mille of its
+// share of the tickets.  Run it with CPUS=1, so that the processes
+// actually compete for one cpu.
+
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NCHILD 3
+#define TOLERANCE 50   // per mille of the total
+
+int tickets[NCHILD] = { 100, 200, 300 };
+
+int
+main(int argc, char *argv[])
+{
+  int start[2], result[2];
+  int pids[NCHILD], counts[NCHILD];
+  int duration = 1000;
+  int i, t0, got, want, diff, count, alltickets, scale, fails;
+  char c, go[NCHILD];
+
+  if(argc > 1)
+    duration = atoi(argv[1]);
+  if(pipe(start) < 0 || pipe(result) < 0){
+    printf(2, "lotteryfair: pipe failed\n");
+    exit();
+  }
+  lottery_seed(uptime());
+
+  for(i = 0; i < NCHILD; i++){
+    if((pids[i] = fork()) == 0){
+      read(start[0], &c, 1);
+      count = 0;
+      t0 = uptime();
+      while(uptime() - t0 < duration)
+        count++;
+      write(result[1], &i, sizeof(i));
+      write(result[1], &count, sizeof(count));
+      exit();
+    }
+    lottery_ticket(pids[i], tickets[i]);
+  }
+  memset(go, 0, sizeof(go));
+  write(start[1], go, NCHILD);
+
+  scale = alltickets = 0;
+  for(i = 0; i < NCHILD; i++){
+    read(result[0], &got, sizeof(got));
+    read(result[0], &counts[got], sizeof(counts[got]));
+    alltickets += tickets[i];
+  }
+  for(i = 0; i < NCHILD; i++){
+    wait();
+    scale += counts[i];
+  }
+  scale /= 1000;
+  if(scale == 0)
+    scale = 1;
+
+  fails = 0;
+  for(i = 0; i < NCHILD; i++){
+    want = tickets[i] * 1000 / alltickets;
+    got = counts[i] / scale;
+    diff = got > want ? got - want : want - got;
+    printf(1, "pid %d: %d tickets, share %d/1000, expected %d/1000\n",
+           pids[i], tickets[i], got, want);
+    if(diff > TOLERANCE)
+      fails++;
+  }
+  printf(1, fails ? "lotteryfair: FAIL\n" : "lotteryfair: OK\n");
+  exit();
+}
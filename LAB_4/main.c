@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 
@@ -27,6 +28,9 @@ main(void)
   consoleinit();   // console hardware
   uartinit();      // serial port
   pinit();         // process table
+  seminit();       // semaphores
+  futexinit();     // futex wait queues
+  lockstressinit(); // lock stress test
   tvinit();        // trap vectors
   binit();         // buffer cache
   fileinit();      // file table
@@ -1,6 +1,11 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC        64  // default limit on live processes
+#define MAXPROC    2048  // highest the limit can be set to
 #define KSTACKSIZE 4096  // size of per-process kernel stack
+#define NKSTACKCACHE  8  // freed kernel stacks kept per CPU
+#define MAXSEM     1024  // most semaphores allocated at once
 #define NCPU          8  // maximum number of CPUs
+#define NLEVEL        4  // lowest scheduling queue level; 0 is real time
+#define HZ          100  // timer interrupts per second under qemu
 #define NOFILE       16  // open files per process
 #define NFILE       100  // open files per system
 #define NINODE       50  // maximum number of active i-nodes
@@ -10,5 +15,5 @@
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
-#define FSSIZE       1000  // size of file system in blocks
+#define FSSIZE       4000  // size of file system in blocks
 
@@ -1,36 +1,137 @@
+// Dining philosophers semaphore benchmark.
+// Usage: philosopher [n] [ticks]
+// n philosophers share n forks, one semaphore each, and eat as
+// often as they can.  First a butler semaphore seats at most n-1
+// at once so that they cannot deadlock; then each takes its left
+// fork and only tries for its right one, putting the left one down
+// again if that is taken.  Reports meals and semaphore acquisitions
+// per second, and the fewest and most meals any one philosopher had.
+
 #include "types.h"
 #include "stat.h"
 #include "user.h"
 
-void phil(int philsoph)
+#define MAXPHIL 32
+
+struct result {
+  uint meals;
+  uint nacquire;   // Semaphore units taken
+};
+
+void
+eat(void)
+{
+  volatile int i;
+
+  for(i = 0; i < 100; i++)
+    ;
+}
+
+void
+phil(int i, int n, int *forks, int butler, int fd, uint end)
 {
-    sem_acquire(5);
-    sem_acquire(philsoph - 1);
-    sem_acquire(philsoph % 5);
-    sleep(5);
-    sem_release(philsoph - 1);
-    sem_release(philsoph % 5);
-    sem_release(5);
-    sleep(5);
+  int left = forks[i], right = forks[(i+1) % n];
+  struct result r;
+
+  r.meals = r.nacquire = 0;
+  while(uptime() < end){
+    if(butler >= 0){
+      sem_acquire(butler);
+      sem_acquire(left);
+      sem_acquire(right);
+      r.nacquire += 3;
+    } else {
+      sem_acquire(left);
+      r.nacquire++;
+      if(sem_tryacquire(right) != 0){
+        sem_release(left);
+        continue;
+      }
+      r.nacquire++;
+    }
+    eat();
+    r.meals++;
+    sem_release(right);
+    sem_release(left);
+    if(butler >= 0)
+      sem_release(butler);
+  }
+  write(fd, &r, sizeof(r));
+  exit();
 }
 
-int main()
+void
+run(int n, int duration, int usebutler)
 {
-    sem_init(0, 1);
-    sem_init(1, 1);
-    sem_init(2, 1);
-    sem_init(3, 1);
-    sem_init(4, 1);
-    sem_init(5, 4);
-
-    for(int i = 0 ; i < 5 ; i++)
-    {
-        int id = fork();
-        if(id==0){
-            phil(i+1);
-            exit();
-        }
+  int forks[MAXPHIL], butler = -1, fd[2], i, pid, nchild;
+  struct result r;
+  uint meals = 0, nacquire = 0, lo = ~0, hi = 0, end;
+
+  for(i = 0; i < n; i++){
+    if((forks[i] = sem_init(1)) < 0){
+      printf(2, "philosopher: sem_init failed\n");
+      exit();
     }
-    while(wait() != -1);
+  }
+  if(usebutler && (butler = sem_init(n - 1)) < 0){
+    printf(2, "philosopher: sem_init failed\n");
+    exit();
+  }
+  if(pipe(fd) < 0){
+    printf(2, "philosopher: pipe failed\n");
     exit();
-}
\ No newline at end of file
+  }
+
+  end = uptime() + duration;
+  for(nchild = 0; nchild < n; nchild++){
+    if((pid = fork()) == 0){
+      close(fd[0]);
+      phil(nchild, n, forks, butler, fd[1], end);
+    }
+    if(pid < 0){
+      // The ones already seated still leave at end.
+      printf(2, "philosopher: fork failed\n");
+      break;
+    }
+  }
+  close(fd[1]);
+  while(read(fd[0], &r, sizeof(r)) == sizeof(r)){
+    meals += r.meals;
+    nacquire += r.nacquire;
+    if(r.meals < lo)
+      lo = r.meals;
+    if(r.meals > hi)
+      hi = r.meals;
+  }
+  close(fd[0]);
+  for(i = 0; i < nchild; i++)
+    wait();
+  for(i = 0; i < n; i++)
+    sem_free(forks[i]);
+  if(butler >= 0)
+    sem_free(butler);
+  if(nchild < n)
+    exit();
+
+  printf(1, "%s: %d meals/sec, %d acquisitions/sec, %d to %d meals each\n",
+         usebutler ? "butler" : "try   ", persec(meals, duration),
+         persec(nacquire, duration), lo, hi);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n, duration;
+
+  n = argnum(argc, argv, 1, 5);
+  duration = argnum(argc, argv, 2, 300);
+  if(n < 2 || n > MAXPHIL || duration < 1){
+    printf(2, "usage: philosopher [n 2-%d] [ticks]\n", MAXPHIL);
+    exit();
+  }
+
+  printf(1, "philosophers %d ticks %d\n", n, duration);
+  run(n, duration, 1);
+  run(n, duration, 0);
+  exit();
+}
@@ -0,0 +1,63 @@
+// Scheduling decision latency benchmark.
+// Usage: pickbench [ticks]
+// For 8, 32 and 64 live processes (counting init, sh and this
+// program), keeps that many CPU-bound processes runnable and
+// reports the average TSC cycles each scheduling decision took.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+int sizes[] = { 8, 32, 64 };
+
+void
+totals(uint *ndecide, uint *cycles)
+{
+  struct schedstat st;
+  int i;
+
+  getschedstat(&st);
+  *ndecide = *cycles = 0;
+  for(i = 0; i < st.ncpu; i++){
+    *ndecide += st.cpu[i].ndecide;
+    *cycles += st.cpu[i].decidecycles;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pids[NPROC];
+  int duration = 200;
+  int i, k, n;
+  uint d0, c0, d1, c1;
+
+  if(argc > 1)
+    duration = atoi(argv[1]);
+
+  for(k = 0; k < sizeof(sizes)/sizeof(sizes[0]); k++){
+    // init, sh and pickbench are already live.
+    for(n = 0; n < sizes[k] - 3; n++){
+      if((pids[n] = fork()) < 0)
+        break;
+      if(pids[n] == 0)
+        for(;;)
+          ;
+    }
+    totals(&d0, &c0);
+    sleep(duration);
+    totals(&d1, &c1);
+    for(i = 0; i < n; i++)
+      kill(pids[i]);
+    for(i = 0; i < n; i++)
+      wait();
+
+    if(d1 == d0)
+      d1++;
+    printf(1, "%d live: %d decisions, %d cycles/decision\n",
+           n + 3, d1 - d0, (c1 - c0) / (d1 - d0));
+  }
+  exit();
+}
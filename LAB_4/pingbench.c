@@ -0,0 +1,118 @@
+// Directed yield benchmark.
+// Usage: pingbench [hogs] [ticks]
+// Bounces a message between two processes through a pair of pipes
+// while CPU-bound hogs compete with them, all on cpu 0, first with
+// plain reads and writes and then with each side calling yield_to()
+// on the other after writing.  Reports round trips per second and
+// the average round trip time.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXHOGS 16
+
+// Each message is the sender's pid, so that the receiver
+// knows whom to yield to.
+void
+echo(int rfd, int wfd, int handoff)
+{
+  int me = getpid(), peer;
+
+  for(;;){
+    if(read(rfd, &peer, sizeof(peer)) != sizeof(peer))
+      exit();
+    write(wfd, &me, sizeof(me));
+    if(handoff)
+      yield_to(peer);
+  }
+}
+
+void
+ping(int rfd, int wfd, int handoff, int fd, uint end)
+{
+  int me = getpid(), peer;
+  uint n = 0;
+
+  while(uptime() < end){
+    write(wfd, &me, sizeof(me));
+    if(handoff && n > 0)
+      yield_to(peer);
+    if(read(rfd, &peer, sizeof(peer)) != sizeof(peer))
+      break;
+    n++;
+  }
+  write(fd, &n, sizeof(n));
+  exit();
+}
+
+uint
+handoffs(struct schedstat *st)
+{
+  uint n = 0;
+  int i;
+
+  for(i = 0; i < st->ncpu; i++)
+    n += st->cpu[i].nhandoff;
+  return n;
+}
+
+void
+run(int nhog, int duration, int handoff)
+{
+  int pids[MAXHOGS], a[2], b[2], res[2], echopid, i, old;
+  struct schedstat st0, st1;
+  uint n = 0, end;
+
+  if(pipe(a) < 0 || pipe(b) < 0 || pipe(res) < 0){
+    printf(2, "pingbench: pipe failed\n");
+    exit();
+  }
+  getschedstat(&st0);
+  old = set_affinity(0, 1);
+  for(i = 0; i < nhog; i++)
+    pids[i] = hog();
+  end = uptime() + duration;
+  if((echopid = fork()) == 0)
+    echo(a[0], b[1], handoff);
+  if(fork() == 0)
+    ping(b[0], a[1], handoff, res[1], end);
+  set_affinity(0, old);
+  close(a[0]); close(a[1]);
+  close(b[0]); close(b[1]);
+  close(res[1]);
+
+  read(res[0], &n, sizeof(n));
+  close(res[0]);
+  getschedstat(&st1);
+  kill(echopid);
+  killwait(pids, nhog);
+  wait();
+  wait();
+
+  printf(1, "%s: %d round trips, %d/sec", handoff ? "yield_to" : "plain   ",
+         n, persec(n, duration));
+  if(n > 0)
+    printf(1, ", %d us each", duration * (1000000 / HZ) / n);
+  printf(1, ", %d handoffs\n", handoffs(&st1) - handoffs(&st0));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nhog, duration;
+
+  nhog = argnum(argc, argv, 1, 2);
+  duration = argnum(argc, argv, 2, 300);
+  if(nhog < 0 || nhog > MAXHOGS || duration < 1){
+    printf(2, "usage: pingbench [hogs 0-%d] [ticks]\n", MAXHOGS);
+    exit();
+  }
+
+  printf(1, "hogs %d ticks %d\n", nhog, duration);
+  run(nhog, duration, 0);
+  run(nhog, duration, 1);
+  exit();
+}
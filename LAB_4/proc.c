@@ -4,26 +4,104 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
-#include "proc.h"
 #include "spinlock.h"
-
+#include "sleeplock.h"
+#include "proc.h"
+#include "traps.h"
+#include "schedstat.h"
+
+#define AGELIMIT 1000    // default ticks a process waits before promotion
+#define STRIDE1 (1<<20)  // stride of a process holding one ticket
+#define BJF_SCALE 1000   // fixed point units per whole in BJF ranks
+#define BALANCE_TICKS 4  // default ticks between load balancing runs
+#define HOT_TICKS 2      // default ticks a process stays cache hot
+#define LOAD_SCALE 100   // fixed point units per process in cpu loads
+#define RT_SCALE 1000    // fixed point units per cpu in real time densities
+#define RT_LIMIT 950     // density a cpu may reserve for real time
+
+#define NPIDHASH 256     // power of two; 8 pids a chain at MAXPROC
+#define PIDHASH(pid) ((pid) & (NPIDHASH-1))
+
+// Process table.
+// struct procs come from their own kcache the first time they are
+// needed and are never freed: when a process is reaped its struct
+// goes on a free stack for the next fork.  So each has a fixed slot
+// number below MAXPROC, by which the ticket trees index it.  At most
+// maxproc processes are live at once; they are kept on a list and
+// hashed by pid so that nothing has to walk the unused ones.
+//
+// Locks are taken in the order wait_lock, ptable.lock, a wait
+// queue's lock, p->lock, rtlock or a ready queue's lock; two ready
+// queues' locks are taken in cpu order.  ptable.lock guards
+// nextpid, the table's lists and the pid hash.
 struct {
   struct spinlock lock;
-  struct proc proc[NPROC];
+  struct kcache *cache;
+  struct proc *slot[MAXPROC];      // Every struct proc, by slot
+  int nslot;
+  struct proc *free[MAXPROC];      // Stack of UNUSED ones
+  int nfree;
+  struct proc *live;               // List of the rest
+  int nlive;
+  struct proc *pidhash[NPIDHASH];  // Chains of live processes by pid
 } ptable;
 
+static int maxproc = NPROC;
+
+// Protects every p->parent, and is held by a parent sleeping in
+// wait() so that no child's exit can be missed.
+static struct spinlock wait_lock;
+
+// Protects every cpu's rtutil.
+static struct spinlock rtlock;
+
 static struct proc *initproc;
 
+// An address space, shared by a process and the threads clone()
+// made from it.  The page table is freed when the last of them is
+// reaped.  grow serializes the calls that read or change the
+// page table's size, so that every sharer agrees on sz; it is
+// taken before ptable.lock.
+struct vm {
+  struct sleeplock grow;
+  volatile uint ref;               // Processes using it; changed by xadd()
+};
+
+static struct kcache *vmcache;
+
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
-static void wakeup1(void *chan);
+static void waitq_init(void);
+static int bjf_before(struct proc*, struct proc*);
+static int stride_before(struct proc*, struct proc*);
+static int fair_before(struct proc*, struct proc*);
+static int edf_before(struct proc*, struct proc*);
+static int release_before(struct proc*, struct proc*);
+static void edf_wake(struct proc*);
+static void balance(struct cpu*);
 
 void
 pinit(void)
 {
+  struct cpu *c;
+
   initlock(&ptable.lock, "ptable");
+  ptable.cache = kcache_create("proc", sizeof(struct proc));
+  vmcache = kcache_create("vm", sizeof(struct vm));
+  initlock(&wait_lock, "wait_lock");
+  waitq_init();
+  for(c = cpus; c < cpus+NCPU; c++){
+    initlock(&c->rq.lock, "runq");
+    c->rq.bjf.before = bjf_before;
+    c->rq.stride.before = stride_before;
+    c->rq.fair.before = fair_before;
+    c->rq.edf.before = edf_before;
+    c->rq.throttled.before = release_before;
+  }
+  initlock(&rtlock, "rtlock");
+  lottery_seed(rdtsc());
 }
 
 // Must be called with interrupts disabled
@@ -65,26 +143,781 @@ myproc(void) {
   return p;
 }
 
+// Per-CPU xorshift32 generator (Marsaglia).  Must be called
+// with interrupts disabled so the cpu's state is not shared.
+static uint
+cpu_rand(struct cpu *c)
+{
+  uint x = c->rng;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return c->rng = x;
+}
+
+// Restart every cpu's generator from seed, so that a sequence
+// of lottery draws can be reproduced.
+void
+lottery_seed(uint seed)
+{
+  struct cpu *c;
+
+  pushcli();
+  for(c = cpus; c < cpus+NCPU; c++){
+    c->rng = seed ^ ((c-cpus+1) * 0x9E3779B9);
+    if(c->rng == 0)
+      c->rng = 1;
+  }
+  popcli();
+}
+
 int rand_number(int n)
 {
   int random;
-  acquire(&tickslock);
-  random = (ticks * 12456) % n;
-  random = (random * ticks) % n;
-  release(&tickslock);
+  pushcli();
+  random = cpu_rand(mycpu()) % n;
+  popcli();
   return random + 1;
 }
 
-float get_priority(int n)
+// BJF parameters are fixed point with BJF_SCALE units per whole,
+// so the scheduler never touches the FPU.  priority is 1/ticket,
+// and execcycle grows by a tenth each time the process is run.
+int get_priority(int n)
+{
+  return BJF_SCALE / n;
+}
+
+// Recompute p's rank after one of its BJF parameters changed.
+static void
+bjf_update(struct proc *p)
+{
+  p->rank = (uint64)p->priority * p->priority_ratio
+          + (uint64)p->arrivaltime * p->arrivaltime_ratio * BJF_SCALE
+          + (uint64)p->execcycle * p->execcycle_ratio;
+}
+
+static int
+bjf_before(struct proc *a, struct proc *b)
+{
+  return a->rank < b->rank;
+}
+
+// Level 2 is scheduled by lottery or, for more predictable
+// short-term shares, by stride scheduling with the ticket
+// count as weight.  Both structures are always kept up to
+// date so that the mode can be switched at any time.
+static int l2mode = L2_LOTTERY;
+
+static int
+stride_before(struct proc *a, struct proc *b)
+{
+  return (int)(a->pass - b->pass) < 0;
+}
+
+// Advance p's pass for the run it is about to get.  p has
+// just been dequeued, so its pass is relative to rq->vpass,
+// and as the least queued it becomes the new vpass.
+static void
+stride_charge(struct runq *rq, struct proc *p)
+{
+  uint stride = STRIDE1 / p->ticket;
+
+  rq->vpass += p->pass;
+  p->pass = stride ? stride : 1;
+}
+
+int
+set_lottery_mode(int mode)
+{
+  int old = l2mode;
+
+  if(mode != L2_LOTTERY && mode != L2_STRIDE)
+    return -1;
+  l2mode = mode;
+  return old;
+}
+
+// Level 4 is completely fair.  A process accrues virtual runtime,
+// the TSC cycles it runs scaled by its weight relative to that of
+// nice 0, and the one with the least runs next.  A queue's
+// minvruntime follows the least virtual runtime waiting on it
+// and never goes back; a process that is not queued keeps its virtual
+// runtime relative to it, so that it can be queued on any cpu.
+#define FAIR_GRAN 1      // ticks a process may run ahead of the rest
+#define FAIR_CREDIT 1    // most ticks a waking sleeper is put behind
+
+// 2^32 / weight for nice -20 to 19, where nice 0 weighs 1024 and
+// each step weighs about 1.25 times less, as in Linux.
+static uint nice_wmult[NICE_MAX-NICE_MIN+1] = {
+      48388,     59856,     76040,     92818,    118348,
+     147320,    184698,    229616,    287308,    360437,
+     449829,    563644,    704093,    875809,   1099582,
+    1376151,   1717300,   2157191,   2708050,   3363326,
+    4194304,   5237765,   6557202,   8165337,  10153587,
+   12820798,  15790321,  19976592,  24970740,  31350126,
+   39045157,  49367440,  61356676,  76695844,  95443717,
+  119304647, 148102320, 186737708, 238609294, 286331153,
+};
+
+// TSC cycles per timer tick, measured by cpu 0.
+static uint tickcycles;
+
+static int
+fair_before(struct proc *a, struct proc *b)
+{
+  return (long long)(a->vruntime - b->vruntime) < 0;
+}
+
+// Virtual runtime for running cycles at p's weight:
+// cycles * 1024 / weight.
+static uint64
+fair_delta(struct proc *p, uint cycles)
+{
+  return ((uint64)cycles * nice_wmult[p->nice - NICE_MIN]) >> 22;
+}
+
+// Bring rq->minvruntime up to the least virtual runtime queued.
+// Called as a level 4 process is picked to run.
+static void
+fair_advance(struct runq *rq)
+{
+  uint64 v = rq->fair.a[0]->vruntime;
+
+  if((long long)(v - rq->minvruntime) > 0)
+    rq->minvruntime = v;
+}
+
+// Charge p for the run it is ending.  Caller must hold p->lock,
+// and p must not be queued.
+static void
+fair_charge(struct proc *p)
+{
+  if(p->level == 4)
+    p->vruntime += fair_delta(p, rdtsc() - p->runstart);
+}
+
+// Place a process that is waking up.  It is assumed to have fallen
+// behind by the time it slept, but by no more than FAIR_CREDIT
+// ticks, so that it runs soon without banking its sleep.
+static void
+fair_place(struct proc *p)
+{
+  long long lag = p->vruntime;
+
+  lag -= (long long)(ticks - p->lastrun) * tickcycles;
+  if(lag < -(long long)FAIR_CREDIT * tickcycles)
+    lag = -(long long)FAIR_CREDIT * tickcycles;
+  if(lag < (long long)p->vruntime)
+    p->vruntime = lag;
+}
+
+//PAGEBREAK: 30
+// Binary min-heap of processes.  h->before(a, b) is non-zero
+// if a should leave the heap before b.  Each process records
+// its position in hidx so it can be removed from the middle.
+#define HIDX(h, p) ((p)->hidx[(h)->kind])
+
+static void
+heap_swap(struct procheap *h, int i, int j)
+{
+  struct proc *t;
+
+  t = h->a[i];
+  h->a[i] = h->a[j];
+  h->a[j] = t;
+  HIDX(h, h->a[i]) = i;
+  HIDX(h, h->a[j]) = j;
+}
+
+static void
+heap_up(struct procheap *h, int i)
+{
+  while(i > 0 && h->before(h->a[i], h->a[(i-1)/2])){
+    heap_swap(h, i, (i-1)/2);
+    i = (i-1)/2;
+  }
+}
+
+static void
+heap_down(struct procheap *h, int i)
+{
+  int l, m;
+
+  for(;;){
+    m = i;
+    l = 2*i + 1;
+    if(l < h->n && h->before(h->a[l], h->a[m]))
+      m = l;
+    if(l+1 < h->n && h->before(h->a[l+1], h->a[m]))
+      m = l+1;
+    if(m == i)
+      return;
+    heap_swap(h, i, m);
+    i = m;
+  }
+}
+
+// Restore heap order after p's key changed in place.
+static void
+heap_fix(struct procheap *h, struct proc *p)
+{
+  heap_up(h, HIDX(h, p));
+  heap_down(h, HIDX(h, p));
+}
+
+static void
+heap_push(struct procheap *h, struct proc *p)
+{
+  HIDX(h, p) = h->n;
+  h->a[h->n++] = p;
+  heap_up(h, HIDX(h, p));
+}
+
+static void
+heap_remove(struct procheap *h, struct proc *p)
+{
+  int i = HIDX(h, p);
+
+  HIDX(h, p) = -1;
+  if(i != --h->n){
+    h->a[i] = h->a[h->n];
+    HIDX(h, h->a[i]) = i;
+    heap_up(h, i);
+    heap_down(h, i);
+  }
+}
+
+// Fenwick tree over process slots holding the tickets of the
+// level 2 processes queued on rq, so a lottery draw and a ticket
+// change each cost O(log MAXPROC).
+static void
+ticket_add(struct runq *rq, struct proc *p, int n)
+{
+  int i;
+
+  for(i = p->slot + 1; i <= MAXPROC; i += i & -i)
+    rq->tree[i] += n;
+  rq->tickets += n;
+}
+
+// Find the process holding ticket number r, 0 <= r < rq->tickets.
+static struct proc*
+ticket_find(struct runq *rq, int r)
+{
+  int i = 0, bit;
+
+  for(bit = 1; bit*2 <= MAXPROC; bit *= 2)
+    ;
+  for(; bit > 0; bit /= 2){
+    if(i + bit <= MAXPROC && rq->tree[i+bit] <= r){
+      i += bit;
+      r -= rq->tree[i];
+    }
+  }
+  return ptable.slot[i];
+}
+
+//PAGEBREAK: 30
+// Per-CPU ready queues.
+// Every RUNNABLE process sits on the ready queue of exactly
+// one cpu, except between the moment scheduler() picks it and
+// the moment it runs.  Each level is a list in queueing order,
+// which level 1 is served from and which aging scans from the
+// head.  Level 2 is also indexed by a ticket tree and a heap
+// ordered by stride pass, level 3 by a heap ordered by BJF rank,
+// and level 4 by a heap ordered by virtual runtime.
+// Each queue has its own lock.  A process's queue links and the
+// fields its queue is ordered by (level, ticket, pass, rank,
+// vruntime) are protected by the queue's lock while it is queued
+// and by p->lock otherwise, so queueing a process takes both.
+
+// Count p, at its level, as work for each cpu it may run on.
+// Level 0 runs only on its own cpu, so it is not counted.
+static void
+count_allowed(struct runq *rq, struct proc *p, int n)
+{
+  int i;
+
+  if(p->level == 0)
+    return;
+  for(i = 0; i < ncpu; i++)
+    if((p->affinity >> i) & 1)
+      rq->nallowed[p->level][i] += n;
+}
+
+static void
+enqueue_proc(struct cpu *c, struct proc *p)
+{
+  struct runq *rq = &c->rq;
+
+  // A throttled real time process waits on its own heap and
+  // does not count as ready.
+  if(p->level == 0 && p->budget <= 0){
+    heap_push(&rq->throttled, p);
+    p->rqcpu = c;
+    return;
+  }
+  p->rqnext = 0;
+  p->rqprev = rq->tail[p->level];
+  if(rq->tail[p->level])
+    rq->tail[p->level]->rqnext = p;
+  else
+    rq->head[p->level] = p;
+  rq->tail[p->level] = p;
+  p->enqtime = ticks;
+  if(p->level == 0)
+    heap_push(&rq->edf, p);
+  if(p->level == 3)
+    heap_push(&rq->bjf, p);
+  if(p->level == 2){
+    ticket_add(rq, p, p->ticket);
+    // Don't let a process bank the time it spent away.
+    if((int)p->pass < 0)
+      p->pass = 0;
+    p->pass += rq->vpass;
+    heap_push(&rq->stride, p);
+  }
+  if(p->level == 4){
+    p->vruntime += rq->minvruntime;
+    heap_push(&rq->fair, p);
+  }
+  rq->count[p->level]++;
+  rq->nready++;
+  count_allowed(rq, p, 1);
+  p->rqcpu = c;
+}
+
+static void
+dequeue_proc(struct proc *p)
+{
+  struct runq *rq = &p->rqcpu->rq;
+
+  if(p->level == 0 && p->budget <= 0){
+    heap_remove(&rq->throttled, p);
+    p->rqcpu = 0;
+    return;
+  }
+  if(p->rqprev)
+    p->rqprev->rqnext = p->rqnext;
+  else
+    rq->head[p->level] = p->rqnext;
+  if(p->rqnext)
+    p->rqnext->rqprev = p->rqprev;
+  else
+    rq->tail[p->level] = p->rqprev;
+  p->rqnext = p->rqprev = 0;
+  if(p->level == 0)
+    heap_remove(&rq->edf, p);
+  if(p->level == 3)
+    heap_remove(&rq->bjf, p);
+  if(p->level == 2){
+    ticket_add(rq, p, -p->ticket);
+    heap_remove(&rq->stride, p);
+    p->pass -= rq->vpass;
+  }
+  if(p->level == 4){
+    heap_remove(&rq->fair, p);
+    p->vruntime -= rq->minvruntime;
+  }
+  rq->count[p->level]--;
+  rq->nready--;
+  count_allowed(rq, p, -1);
+  p->rqcpu = 0;
+}
+
+// Queue p, just taken off another cpu's queue where it was queued
+// at enqtime, on c without losing its place in line for aging.
+// The lists are kept in queueing order, so it goes after the last
+// process queued no later than it.
+static void
+requeue_proc(struct cpu *c, struct proc *p, uint enqtime)
+{
+  struct runq *rq = &c->rq;
+  struct proc *q;
+  int level = p->level;
+
+  enqueue_proc(c, p);
+  if(rq->tail[level] != p)
+    return;    // throttled, so not on the list
+  p->enqtime = enqtime;
+  for(q = p->rqprev; q && (int)(q->enqtime - enqtime) > 0; q = q->rqprev)
+    ;
+  if(q == p->rqprev)
+    return;
+  rq->tail[level] = p->rqprev;
+  p->rqprev->rqnext = 0;
+  p->rqprev = q;
+  p->rqnext = q ? q->rqnext : rq->head[level];
+  p->rqnext->rqprev = p;
+  if(q)
+    q->rqnext = p;
+  else
+    rq->head[level] = p;
+}
+
+static int
+cpu_allowed(struct proc *p, struct cpu *c)
+{
+  return (p->affinity >> (c - cpus)) & 1;
+}
+
+// Make sure a cpu notices p, just queued on c: c itself if it
+// is halted in idle(), otherwise any halted cpu that may steal p.
+static void
+kick_cpu(struct cpu *c, struct proc *p)
+{
+  struct cpu *c1;
+
+  // Order the enqueue before the loads of the idle flags;
+  // idle() does the converse.
+  __sync_synchronize();
+  if(!c->idle && p->level != 0){
+    for(c1 = cpus; c1 < cpus+ncpu; c1++){
+      if(c1->idle && cpu_allowed(p, c1)){
+        c = c1;
+        break;
+      }
+    }
+  }
+  if(c->idle && c != mycpu())
+    lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+// The cpu to queue p on: the one it last ran on, whose caches
+// are most likely to still hold its state, if p may run there,
+// or else the allowed cpu with the least waiting.  A real time
+// process always goes to the cpu it is reserved on.
+static struct cpu*
+home_cpu(struct proc *p)
+{
+  struct cpu *c, *best = 0;
+
+  if(p->level == 0)
+    return p->rtcpu;
+  if(cpu_allowed(p, p->lastcpu))
+    return p->lastcpu;
+  for(c = cpus; c < cpus+ncpu; c++)
+    if(cpu_allowed(p, c) && (best == 0 || c->rq.nready < best->rq.nready))
+      best = c;
+  return best;
+}
+
+// Mark p RUNNABLE and queue it on its home cpu.
+// Caller must hold p->lock.
+static void
+make_runnable(struct proc *p)
+{
+  struct cpu *c = home_cpu(p);
+
+  p->state = RUNNABLE;
+  if(p->level == 4)
+    fair_place(p);
+  if(p->level == 0)
+    edf_wake(p);
+  acquire(&c->rq.lock);
+  enqueue_proc(c, p);
+  release(&c->rq.lock);
+  kick_cpu(c, p);
+}
+
+// Lock the ready queue holding p and return its cpu, or return 0
+// if p is not queued.  The caller holds p->lock, so p cannot be
+// queued meanwhile, but another cpu may take it off, so look
+// again once the lock is held.
+static struct cpu*
+lock_queue(struct proc *p)
+{
+  struct cpu *c;
+
+  while((c = p->rqcpu) != 0){
+    acquire(&c->rq.lock);
+    if(p->rqcpu == c)
+      return c;
+    release(&c->rq.lock);
+  }
+  return 0;
+}
+
+static void
+unlock_queue(struct cpu *c)
+{
+  if(c)
+    release(&c->rq.lock);
+}
+
+// Move p to another level, keeping it on the same ready queue.
+// Caller must hold the queue's lock, or p->lock if p is not queued.
+static void
+set_level(struct proc *p, int level)
+{
+  struct cpu *c = p->rqcpu;
+
+  if(c)
+    dequeue_proc(p);
+  p->level = level;
+  if(c)
+    enqueue_proc(c, p);
+}
+
+//PAGEBREAK: 30
+// Level 0 is earliest deadline first, for periodic real time jobs.
+// A process reserves runtime ticks of every period, and each job,
+// released at the start of a period, should be done within
+// reldeadline ticks.  A job ends when the process blocks or when
+// it has run for its whole budget; in the latter case the process
+// is throttled until its next period.  A reservation is admitted
+// on the first allowed cpu where the densities runtime/reldeadline
+// add up to at most RT_LIMIT, which leaves time for the other
+// levels and makes the cpu's jobs meet their deadlines, and the
+// process then runs only on that cpu.
+
+static int
+edf_before(struct proc *a, struct proc *b)
+{
+  return (int)(a->absdeadline - b->absdeadline) < 0;
+}
+
+static int
+release_before(struct proc *a, struct proc *b)
+{
+  return (int)(a->release + a->period - b->release - b->period) < 0;
+}
+
+static int
+rt_density(int runtime, int deadline)
+{
+  return (runtime * RT_SCALE + deadline - 1) / deadline;
+}
+
+// Give back p's reservation, if it has one.
+// Caller must hold p->lock.
+static void
+rt_unreserve(struct proc *p)
+{
+  if(p->rtcpu == 0)
+    return;
+  acquire(&rtlock);
+  p->rtcpu->rtutil -= rt_density(p->runtime, p->reldeadline);
+  release(&rtlock);
+  p->rtcpu = 0;
+}
+
+static void
+edf_new_job(struct proc *p, uint release)
+{
+  p->release = release;
+  p->absdeadline = release + p->reldeadline;
+  p->budget = p->runtime;
+  p->jobdone = 0;
+}
+
+// End p's current job, if it has not ended already.
+static void
+edf_job_end(struct proc *p)
+{
+  if(p->jobdone)
+    return;
+  p->jobdone = 1;
+  p->njob++;
+  if((int)(ticks - p->absdeadline) > 0)
+    p->nmiss++;
+}
+
+// A process waking after its period is over starts a new job.
+// One waking sooner carries on with the budget its job has left.
+// Caller must hold p->lock.
+static void
+edf_wake(struct proc *p)
+{
+  if((int)(ticks - (p->release + p->period)) >= 0)
+    edf_new_job(p, ticks);
+}
+
+// Release the next jobs of c's throttled processes whose next
+// period has begun.
+static void
+edf_replenish(struct cpu *c)
+{
+  struct runq *rq = &c->rq;
+  struct proc *p;
+  uint next;
+
+  acquire(&rq->lock);
+  while(rq->throttled.n > 0){
+    p = rq->throttled.a[0];
+    next = p->release + p->period;
+    if((int)(ticks - next) < 0)
+      break;
+    dequeue_proc(p);
+    // Don't release a backlog of jobs after a long overrun.
+    if((int)(ticks - (next + p->period)) >= 0)
+      next = ticks;
+    edf_new_job(p, next);
+    enqueue_proc(c, p);
+  }
+  release(&rq->lock);
+}
+
+// Return non-zero if a job with an earlier deadline than that of
+// p, running on c, is waiting there.
+static int
+edf_preempt(struct cpu *c, struct proc *p)
+{
+  struct runq *rq = &c->rq;
+  int earlier = 0;
+
+  acquire(&rq->lock);
+  if(rq->edf.n > 0)
+    earlier = edf_before(rq->edf.a[0], p);
+  release(&rq->lock);
+  return earlier;
+}
+
+// Give p the next pid and make it live.  Pids are handed out in
+// sequence, so their low bits spread them evenly over the hash
+// chains.  Caller must hold ptable.lock.
+static void
+proc_insert(struct proc *p)
+{
+  p->pid = nextpid++;
+  p->pidnext = ptable.pidhash[PIDHASH(p->pid)];
+  ptable.pidhash[PIDHASH(p->pid)] = p;
+  p->liveprev = 0;
+  p->livenext = ptable.live;
+  if(ptable.live)
+    ptable.live->liveprev = p;
+  ptable.live = p;
+  ptable.nlive++;
+}
+
+// Caller must hold ptable.lock.
+static void
+proc_remove(struct proc *p)
+{
+  struct proc **pp;
+
+  for(pp = &ptable.pidhash[PIDHASH(p->pid)]; *pp; pp = &(*pp)->pidnext){
+    if(*pp == p){
+      *pp = p->pidnext;
+      break;
+    }
+  }
+  p->pidnext = 0;
+  p->pid = 0;
+  if(p->liveprev)
+    p->liveprev->livenext = p->livenext;
+  else
+    ptable.live = p->livenext;
+  if(p->livenext)
+    p->livenext->liveprev = p->liveprev;
+  p->livenext = p->liveprev = 0;
+  ptable.nlive--;
+}
+
+// Return the process with the given pid, locked, or 0.
+static struct proc*
+lock_pid(int pid)
 {
-  return 1/n;
+  struct proc *p;
+
+  if(pid <= 0)
+    return 0;
+  acquire(&ptable.lock);
+  for(p = ptable.pidhash[PIDHASH(pid)]; p; p = p->pidnext)
+    if(p->pid == pid)
+      break;
+  if(p){
+    acquire(&p->lock);
+    // freeproc() marks p UNUSED before taking it off the hash.
+    if(p->state == UNUSED){
+      release(&p->lock);
+      p = 0;
+    }
+  }
+  release(&ptable.lock);
+  return p;
+}
+
+int
+set_maxproc(int n)
+{
+  int old;
+
+  if(n < 1 || n > MAXPROC)
+    return -1;
+  acquire(&ptable.lock);
+  old = maxproc;
+  maxproc = n;
+  release(&ptable.lock);
+  return old;
+}
+
+// Freed kernel stacks are kept in a small per-cpu cache and
+// handed out again as they are, skipping kfree()'s poison fill
+// and the shared free list.
+static char*
+kstack_alloc(void)
+{
+  struct cpu *c;
+  char *s = 0;
+
+  pushcli();
+  c = mycpu();
+  if(c->nkstack > 0){
+    s = c->kstackcache[--c->nkstack];
+    c->kstackhit++;
+  } else
+    c->kstackmiss++;
+  popcli();
+  if(s == 0)
+    s = kalloc();
+  return s;
+}
+
+static void
+kstack_free(char *s)
+{
+  struct cpu *c;
+
+  pushcli();
+  c = mycpu();
+  if(c->nkstack < NKSTACKCACHE){
+    c->kstackcache[c->nkstack++] = s;
+    s = 0;
+  }
+  popcli();
+  if(s)
+    kfree(s);
+}
+
+// Release p's kernel stack and pid and put it back on the free
+// stack.  Caller must hold p->lock, which this releases.
+static void
+freeproc(struct proc *p)
+{
+  if(p->kstack)
+    kstack_free(p->kstack);
+  p->kstack = 0;
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+  release(&p->lock);
+
+  acquire(&ptable.lock);
+  proc_remove(p);
+  ptable.free[ptable.nfree++] = p;
+  release(&ptable.lock);
 }
 
 //PAGEBREAK: 32
-// Look in the process table for an UNUSED proc.
+// Take an UNUSED proc off the free stack, or allocate a new
+// one, unless maxproc processes are live already.
 // If found, change state to EMBRYO and initialize
 // state required to run in the kernel.
-// Otherwise return 0.
+// Otherwise return 0.  Returns with p->lock held.
 static struct proc*
 allocproc(void)
 {
@@ -92,36 +925,49 @@ allocproc(void)
   char *sp;
 
   acquire(&ptable.lock);
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == UNUSED)
-      goto found;
-
+  if(ptable.nlive >= maxproc)
+    goto fail;
+  if(ptable.nfree > 0)
+    p = ptable.free[--ptable.nfree];
+  else if(ptable.nslot < MAXPROC && (p = kcache_alloc(ptable.cache)) != 0){
+    memset(p, 0, sizeof(*p));
+    initlock(&p->lock, "proc");
+    p->slot = ptable.nslot;
+    ptable.slot[ptable.nslot++] = p;
+  } else
+    goto fail;
+  acquire(&p->lock);
+  p->state = EMBRYO;
+  proc_insert(p);
   release(&ptable.lock);
-  return 0;
 
-found:
-  p->state = EMBRYO;
-  p->pid = nextpid++;
   p->level = 2;
   p->cycle = 0;
-  p->wait = 0;
+  p->nticks = 0;
   p->ticket = rand_number(100);
   p->priority = get_priority(p->ticket);
-  acquire(&tickslock);
   p->arrivaltime = ticks;
-  release(&tickslock);
   p->execcycle = 0;
   p->cpu_time = 0;
   p->priority_ratio = 1;
   p->arrivaltime_ratio = 1;
   p->execcycle_ratio = 1;
-  
-  release(&ptable.lock);
+  bjf_update(p);
+  p->lastcpu = mycpu();
+  p->affinity = ~0;
+  p->nmigrate = 0;
+  p->pass = 0;
+  p->vruntime = 0;
+  p->nice = 0;
+  p->lastrun = ticks;
+  p->rtcpu = 0;
+  p->njob = p->nmiss = p->noverrun = 0;
+  p->vm = 0;
+  p->isthread = 0;
 
   // Allocate kernel stack.
-  if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+  if((p->kstack = kstack_alloc()) == 0){
+    freeproc(p);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -141,6 +987,55 @@ found:
   p->context->eip = (uint)forkret;
 
   return p;
+
+fail:
+  release(&ptable.lock);
+  return 0;
+}
+
+// Return a new address space with one user, or 0.
+struct vm*
+vm_alloc(void)
+{
+  struct vm *vm;
+
+  if((vm = kcache_alloc(vmcache)) == 0)
+    return 0;
+  initsleeplock(&vm->grow, "vm");
+  vm->ref = 1;
+  return vm;
+}
+
+// Drop a reference to vm, whose page table is pgdir, freeing
+// both with the last one.
+void
+vm_put(struct vm *vm, pde_t *pgdir)
+{
+  if(xadd(&vm->ref, -1) == 1){
+    if(pgdir)
+      freevm(pgdir);
+    kcache_free(vmcache, vm);
+  }
+}
+
+// Switch the current process to the address space vm, with page
+// table pgdir and size sz, for exec().  Any other threads keep
+// the old one.
+void
+setvm(struct vm *vm, pde_t *pgdir, uint sz)
+{
+  struct proc *curproc = myproc();
+  struct vm *oldvm = curproc->vm;
+  pde_t *oldpgdir = curproc->pgdir;
+
+  // growproc() in another thread sets sz for everyone on oldvm.
+  acquiresleep(&oldvm->grow);
+  curproc->vm = vm;
+  curproc->pgdir = pgdir;
+  curproc->sz = sz;
+  releasesleep(&oldvm->grow);
+  switchuvm(curproc);
+  vm_put(oldvm, oldpgdir);
 }
 
 //PAGEBREAK: 32
@@ -154,7 +1049,7 @@ userinit(void)
   p = allocproc();
   
   initproc = p;
-  if((p->pgdir = setupkvm()) == 0)
+  if((p->pgdir = setupkvm()) == 0 || (p->vm = vm_alloc()) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
   p->sz = PGSIZE;
@@ -171,35 +1066,93 @@ userinit(void)
   p->cwd = namei("/");
 
   // this assignment to p->state lets other cores
-  // run this process. the acquire forces the above
-  // writes to be visible, and the lock is also needed
-  // because the assignment might not be atomic.
-  acquire(&ptable.lock);
-
-  p->state = RUNNABLE;
+  // run this process. the release forces the above
+  // writes to be visible.
+  make_runnable(p);
 
-  release(&ptable.lock);
+  release(&p->lock);
 }
 
-// Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Grow current process's memory, and that of the threads
+// sharing it, by n bytes.
+// Return the old size on success, -1 on failure.
 int
 growproc(int n)
 {
-  uint sz;
-  struct proc *curproc = myproc();
+  uint sz, oldsz;
+  struct proc *curproc = myproc(), *p;
+  struct vm *vm = curproc->vm;
 
-  sz = curproc->sz;
+  acquiresleep(&vm->grow);
+  sz = oldsz = curproc->sz;
   if(n > 0){
     if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
-      return -1;
+      goto bad;
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
-      return -1;
+    // Another thread's cpu could still have the freed
+    // pages in its TLB.
+    if(vm->ref > 1 || (sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+      goto bad;
   }
-  curproc->sz = sz;
+  acquire(&ptable.lock);
+  for(p = ptable.live; p; p = p->livenext)
+    if(p->vm == vm)
+      p->sz = sz;
+  release(&ptable.lock);
+  releasesleep(&vm->grow);
   switchuvm(curproc);
-  return 0;
+  return oldsz;
+
+bad:
+  releasesleep(&vm->grow);
+  return -1;
+}
+
+// Each process keeps its running children and its zombie children
+// on two lists linked through sibnext/sibprev, so that wait() and
+// exit() look only at the caller's own children.  Protected by
+// wait_lock.
+static void
+sib_push(struct proc **head, struct proc *p)
+{
+  p->sibprev = 0;
+  p->sibnext = *head;
+  if(*head)
+    (*head)->sibprev = p;
+  *head = p;
+}
+
+static void
+sib_remove(struct proc **head, struct proc *p)
+{
+  if(p->sibprev)
+    p->sibprev->sibnext = p->sibnext;
+  else
+    *head = p->sibnext;
+  if(p->sibnext)
+    p->sibnext->sibprev = p->sibprev;
+  p->sibnext = p->sibprev = 0;
+}
+
+// Hand every process on list to initproc, putting them at the
+// front of the list *head of initproc's.
+static void
+sib_adopt(struct proc **head, struct proc *list)
+{
+  struct proc *p;
+
+  if(list == 0)
+    return;
+  for(p = list; ; p = p->sibnext){
+    p->parent = initproc;
+    p->isthread = 0;   // so that init's wait() reaps it
+    if(p->sibnext == 0)
+      break;
+  }
+  p->sibnext = *head;
+  if(*head)
+    (*head)->sibprev = p;
+  *head = list;
 }
 
 // Create a new process copying p as the parent.
@@ -213,19 +1166,26 @@ fork(void)
   struct proc *curproc = myproc();
 
   // Allocate process.
+  // Another thread must not grow the image while it is copied.
+  acquiresleep(&curproc->vm->grow);
   if((np = allocproc()) == 0){
+    releasesleep(&curproc->vm->grow);
     return -1;
   }
 
   // Copy process state from proc.
+  if((np->vm = vm_alloc()) == 0){
+    freeproc(np);
+    releasesleep(&curproc->vm->grow);
+    return -1;
+  }
   if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
-    kfree(np->kstack);
-    np->kstack = 0;
-    np->state = UNUSED;
+    vm_put(np->vm, 0);
+    freeproc(np);
+    releasesleep(&curproc->vm->grow);
     return -1;
   }
   np->sz = curproc->sz;
-  np->parent = curproc;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
@@ -235,16 +1195,24 @@ fork(void)
     if(curproc->ofile[i])
       np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
+  np->affinity = curproc->affinity;
+  np->nice = curproc->nice;
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
   pid = np->pid;
 
-  acquire(&ptable.lock);
+  release(&np->lock);
+  releasesleep(&curproc->vm->grow);
 
-  np->state = RUNNABLE;
+  acquire(&wait_lock);
+  np->parent = curproc;
+  sib_push(&curproc->children, np);
+  release(&wait_lock);
 
-  release(&ptable.lock);
+  acquire(&np->lock);
+  make_runnable(np);
+  release(&np->lock);
 
   return pid;
 }
@@ -256,7 +1224,6 @@ void
 exit(void)
 {
   struct proc *curproc = myproc();
-  struct proc *p;
   int fd;
 
   if(curproc == initproc)
@@ -275,168 +1242,565 @@ exit(void)
   end_op();
   curproc->cwd = 0;
 
-  acquire(&ptable.lock);
+  acquire(&wait_lock);
+
+  // Pass abandoned children to init.
+  sib_adopt(&initproc->children, curproc->children);
+  if(curproc->zombies){
+    sib_adopt(&initproc->zombies, curproc->zombies);
+    wakeup(initproc);
+  }
+  curproc->children = curproc->zombies = 0;
+
+  // Parent might be sleeping in wait().
+  sib_remove(&curproc->parent->children, curproc);
+  sib_push(&curproc->parent->zombies, curproc);
+  wakeup(curproc->parent);
+
+  acquire(&curproc->lock);
+  rt_unreserve(curproc);
+  curproc->state = ZOMBIE;
+  release(&wait_lock);
+
+  // Jump into the scheduler, never to return.
+  sched();
+  panic("zombie exit");
+}
+
+// Create a thread that shares the caller's address space and
+// open files, running fn(arg) on the user stack page that starts
+// at stack.  fn must not return.  join() reaps it.
+// Returns the thread's pid, or -1.
+int
+clone(uint fn, uint arg, uint stack)
+{
+  int i, pid;
+  uint sp, ustack[2];
+  struct proc *np;
+  struct proc *curproc = myproc();
+  struct vm *vm = curproc->vm;
+
+  acquiresleep(&vm->grow);
+  if(stack + PGSIZE < stack || stack + PGSIZE > curproc->sz)
+    goto bad;
+  // A fake return PC, then the argument.
+  sp = stack + PGSIZE - sizeof(ustack);
+  ustack[0] = 0xffffffff;
+  ustack[1] = arg;
+  if(copyout(curproc->pgdir, sp, ustack, sizeof(ustack)) < 0)
+    goto bad;
+  if((np = allocproc()) == 0)
+    goto bad;
+
+  np->vm = vm;
+  xadd(&vm->ref, 1);
+  np->pgdir = curproc->pgdir;
+  np->sz = curproc->sz;
+  release(&np->lock);
+  releasesleep(&vm->grow);
+
+  *np->tf = *curproc->tf;
+  np->tf->eip = fn;
+  np->tf->esp = sp;
+  np->ustack = stack;
+
+  for(i = 0; i < NOFILE; i++)
+    if(curproc->ofile[i])
+      np->ofile[i] = filedup(curproc->ofile[i]);
+  np->cwd = idup(curproc->cwd);
+  np->affinity = curproc->affinity;
+  np->nice = curproc->nice;
+
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  pid = np->pid;
+
+  acquire(&wait_lock);
+  np->parent = curproc;
+  np->isthread = 1;
+  sib_push(&curproc->children, np);
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  make_runnable(np);
+  release(&np->lock);
+
+  return pid;
+
+bad:
+  releasesleep(&vm->grow);
+  return -1;
+}
+
+// Reap a child that has exited: one made by fork() if thread
+// is 0, or by clone() if it is 1.  Return its pid, and if stack
+// is not 0, the user stack clone() was given in *stack.
+// Return -1 if this process has no such children.
+static int
+reap(int thread, uint *stack)
+{
+  struct proc *p;
+  int pid;
+  struct proc *curproc = myproc();
+  
+  acquire(&wait_lock);
+  for(;;){
+    for(p = curproc->zombies; p; p = p->sibnext)
+      if(p->isthread == thread)
+        break;
+    if(p){
+      sib_remove(&curproc->zombies, p);
+      // A zombie holds its lock until it is off its kernel stack.
+      acquire(&p->lock);
+      pid = p->pid;
+      if(stack)
+        *stack = p->ustack;
+      vm_put(p->vm, p->pgdir);
+      p->vm = 0;
+      p->pgdir = 0;
+      freeproc(p);
+      release(&wait_lock);
+      return pid;
+    }
+
+    // No point waiting if we don't have any children.
+    for(p = curproc->children; p; p = p->sibnext)
+      if(p->isthread == thread)
+        break;
+    if(p == 0 || curproc->killed){
+      release(&wait_lock);
+      return -1;
+    }
+
+    // Wait for children to exit.  (See wakeup call in exit.)
+    sleep(curproc, &wait_lock);  //DOC: wait-sleep
+  }
+}
+
+// Wait for a child process to exit and return its pid.
+// Return -1 if this process has no children.
+int
+wait(void)
+{
+  return reap(0, 0);
+}
+
+// Wait for a thread made by the caller to exit and return its
+// pid, and in *stack the stack it was given.
+// Return -1 if the caller has no threads.
+int
+join(uint *stack)
+{
+  return reap(1, stack);
+}
+
+struct proc* earliest_deadline(struct runq *rq)
+{
+  if(rq->edf.n == 0)
+    return 0;
+  return rq->edf.a[0];
+}
+
+// Level 1 is served in the order processes were queued.  A process
+// is queued when it yields, so the head is the one that has been
+// off the cpu longest.
+struct proc* round_robin(struct runq *rq)
+{
+  return rq->head[1];
+}
+
+struct proc* get_lottery(struct runq *rq)
+{
+  int rand_ticket = 0;
+
+  if(rq->tickets == 0)
+    return 0;
+
+  rand_ticket = cpu_rand(mycpu()) % rq->tickets;
+  return ticket_find(rq, rand_ticket);
+}
+
+struct proc* get_stride(struct runq *rq)
+{
+  if(rq->stride.n == 0)
+    return 0;
+  return rq->stride.a[0];
+}
+
+struct proc* level2_policy(struct runq *rq)
+{
+  if(l2mode == L2_STRIDE)
+    return get_stride(rq);
+  return get_lottery(rq);
+}
+
+struct proc* best_job_first(struct runq *rq)
+{
+  if(rq->bjf.n == 0)
+    return 0;
+  return rq->bjf.a[0];
+}
+
+struct proc* completely_fair(struct runq *rq)
+{
+  if(rq->fair.n == 0)
+    return 0;
+  return rq->fair.a[0];
+}
+
+// Processes waiting below level 1 for agelimit ticks are promoted
+// to level 1.  A process's wait is measured from the time it was
+// queued, and each level's list is in queueing order, so only the
+// heads can be due.
+static uint agelimit = AGELIMIT;
+
+static struct proc*
+aged_proc(struct runq *rq)
+{
+  struct proc *p;
+  int level;
+
+  for(level = 2; level <= NLEVEL; level++)
+    if((p = rq->head[level]) != 0 && ticks - p->enqtime >= agelimit)
+      return p;
+  return 0;
+}
+
+int
+set_aging(int limit)
+{
+  int old = agelimit;
+
+  if(limit < 1)
+    return -1;
+  agelimit = limit;
+  return old;
+}
+
+static int balance_ticks = BALANCE_TICKS;
+static uint hot_ticks = HOT_TICKS;
+
+// Length in ticks of the time slice a process gets at each level.
+// The lower levels run longer jobs, which lose more to switching.
+static int quantum[NLEVEL+1] = {
+[1] 1,
+[2] 2,
+[3] 4,
+[4] 8,
+};
+
+// Set the quantum of a level, or only return it if ticks is 0.
+// Returns the old quantum.
+int
+set_quantum(int level, int ticks)
+{
+  int old;
 
-  // Parent might be sleeping in wait().
-  wakeup1(curproc->parent);
+  if(level < 1 || level > NLEVEL || ticks < 0)
+    return -1;
+  old = quantum[level];
+  if(ticks > 0)
+    quantum[level] = ticks;
+  return old;
+}
 
-  // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == curproc){
-      p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
-    }
+// Return non-zero if the level 4 process p, running on c, has
+// got FAIR_GRAN ticks ahead of a process waiting there.
+static int
+fair_ahead(struct cpu *c, struct proc *p)
+{
+  struct runq *rq = &c->rq;
+  long long v;
+  int ahead = 0;
+
+  acquire(&rq->lock);
+  if(rq->fair.n > 0){
+    v = p->vruntime + fair_delta(p, rdtsc() - p->runstart);
+    v -= rq->fair.a[0]->vruntime - rq->minvruntime;
+    ahead = v > (long long)FAIR_GRAN * tickcycles;
   }
-
-  // Jump into the scheduler, never to return.
-  curproc->state = ZOMBIE;
-  sched();
-  panic("zombie exit");
+  release(&rq->lock);
+  return ahead;
 }
 
-// Wait for a child process to exit and return its pid.
-// Return -1 if this process has no children.
-int
-wait(void)
+// Called on every cpu's timer interrupt.  Charges the running
+// process for the tick; trap() preempts it when its slice is
+// used up, or at once if a higher level has work waiting here
+// or, at levels 0 and 4, if a waiting process should run first.
+// A level 0 process's slice is its budget.  Also releases
+// throttled real time jobs, keeps the cpu's load average and
+// balances it periodically.
+void
+sched_tick(void)
 {
+  static uint lasttsc;
+  struct cpu *c = mycpu();
+  struct runq *rq = &c->rq;
   struct proc *p;
-  int havekids, pid;
-  struct proc *curproc = myproc();
-  
-  acquire(&ptable.lock);
-  for(;;){
-    // Scan through table looking for exited children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
-      havekids = 1;
-      if(p->state == ZOMBIE){
-        // Found one.
-        pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
-        release(&ptable.lock);
-        return pid;
-      }
-    }
-
-    // No point waiting if we don't have any children.
-    if(!havekids || curproc->killed){
-      release(&ptable.lock);
-      return -1;
+  uint tsc;
+  int level;
+
+  if(c == cpus){
+    tsc = rdtsc();
+    if(lasttsc)
+      tickcycles = tsc - lasttsc;
+    lasttsc = tsc;
+  }
+  if(c->idle)
+    c->idleticks++;
+  if(rq->throttled.n > 0)
+    edf_replenish(c);
+
+  if((p = c->proc) != 0){
+    p->nticks++;
+    p->slice--;
+    for(level = 0; level < p->level; level++)
+      if(rq->count[level] > 0)
+        p->slice = 0;
+    if(p->level == 4 && rq->count[4] > 0 && fair_ahead(c, p))
+      p->slice = 0;
+    if(p->level == 0 && rq->count[0] > 0 && edf_preempt(c, p))
+      p->slice = 0;
+    // Throttle a real time job that has used up its budget.
+    if(p->level == 0 && --p->budget <= 0 && !p->jobdone){
+      p->noverrun++;
+      edf_job_end(p);
     }
+  }
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-    sleep(curproc, &ptable.lock);  //DOC: wait-sleep
+  // Exponential average with a weight of 1/8 per tick.
+  c->load = (c->load*7 + (rq->nready + (p != 0))*LOAD_SCALE) / 8;
+  if(balance_ticks > 0 && ++c->baltick >= balance_ticks){
+    c->baltick = 0;
+    balance(c);
   }
+
+  // Look without the lock first; most ticks promote nothing.
+  if(aged_proc(rq) == 0)
+    return;
+  acquire(&rq->lock);
+  while((p = aged_proc(rq)) != 0)
+    set_level(p, 1);
+  release(&rq->lock);
 }
 
-struct proc* round_robin(void)
+// Return non-zero if c has a process waiting to run, or another
+// cpu has one that c may steal.  Reads the counts without the
+// queue locks, so it is only a hint.
+static int
+work_queued(struct cpu *c)
 {
-  struct proc *p, *final= 0;
-  int now = ticks;
-  int max_proc = -1000000;
-  //int proc_available = 0;
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if(p->state != RUNNABLE || p->level != 1)
-      continue;
+  struct cpu *c1;
+  int level;
+
+  if(c->rq.nready > 0)
+    return 1;
+  for(c1 = cpus; c1 < cpus+ncpu; c1++)
+    for(level = 1; c1 != c && level <= NLEVEL; level++)
+      if(c1->rq.nallowed[level][c - cpus] > 0)
+        return 1;
+  return 0;
+}
 
-    if(now - p->cpu_time > max_proc)
-    {
-      final = p;
-      max_proc = now - p->cpu_time;
-    }
-    else
-      continue;
-  }
-  return final;
+// Halt until an interrupt arrives, unless work was queued after
+// the caller looked.  kick_cpu() sends an interrupt to wake a
+// halted cpu.  sti only takes effect after the next instruction,
+// so no interrupt can slip in between the last look and the hlt.
+static void
+idle(struct cpu *c)
+{
+  cli();
+  c->idle = 1;
+  __sync_synchronize();
+  if(!work_queued(c))
+    asm volatile("sti; hlt");
+  c->idle = 0;
+  sti();
 }
 
-struct proc* get_lottery(void)
+// The cpu other than c with the most processes waiting at level
+// that c may run.
+static struct cpu*
+busiest_cpu(struct cpu *c, int level)
 {
-  struct proc *p;
-  struct proc *final = 0;
-  int total_ticket = 0;
-  int rand_ticket = 0;
-  int current_ticket = 0;
+  struct cpu *c1, *best = 0;
+  int i = c - cpus;
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if(p->state != RUNNABLE || p->level != 2)
+  for(c1 = cpus; c1 < cpus+ncpu; c1++){
+    if(c1 == c || c1->rq.nallowed[level][i] == 0)
       continue;
-    total_ticket += p->ticket;
+    if(best == 0 || c1->rq.nallowed[level][i] > best->rq.nallowed[level][i])
+      best = c1;
   }
+  return best;
+}
 
-  if(total_ticket == 0)
-    return 0;
+// The first process waiting at level on rq that may run on c.
+static struct proc*
+first_allowed(struct runq *rq, int level, struct cpu *c)
+{
+  struct proc *p;
 
-  rand_ticket = ticks % total_ticket;
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if(p->state != RUNNABLE || p->level != 2)
-      continue;
-    current_ticket += p->ticket;
+  for(p = rq->head[level]; p; p = p->rqnext)
+    if(cpu_allowed(p, c))
+      return p;
+  return 0;
+}
 
-    if(rand_ticket < current_ticket)
-    {
-      final = p;
-      break;
-    }
+//PAGEBREAK: 30
+// Load balancing.
+// pick_next() only steals when a cpu has nothing better to run,
+// so a cpu can keep a long queue while others each run one
+// process.  Every balance_ticks ticks each cpu compares its queue
+// at every level with the longest other queue at that level and
+// pulls half the difference.  A process that stopped running less
+// than hot_ticks ago probably still has its working set in its
+// cpu's caches, and moving it would cost more than it waits, so it
+// is left where it is.  If only hot processes are found for a few
+// runs in a row the imbalance is not going away by itself, and
+// the next run takes them too.
+#define NPULL 4          // most processes one run moves
+#define BALANCE_TRIES 3  // runs that may skip hot processes
+
+static int
+cache_hot(struct proc *p)
+{
+  return ticks - p->lastrun < hot_ticks;
+}
+
+// Lock the ready queues of two cpus, lower cpu first.
+static void
+lock_two(struct cpu *a, struct cpu *b)
+{
+  if(a > b){
+    struct cpu *t = a;
+    a = b;
+    b = t;
   }
-  return final;
+  acquire(&a->rq.lock);
+  acquire(&b->rq.lock);
 }
 
-struct proc* best_job_first(void)
+// Move up to n processes waiting at level on src's queue to c's.
+// Returns the number moved.  Caller holds both queues' locks.
+static int
+pull(struct cpu *c, struct cpu *src, int level, int n)
 {
-  struct proc* p, *final = 0;
-  float rank = 0;
-  float min_rank = 10000000;
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if (p->state != RUNNABLE || p->level != 3)
+  struct proc *p, *prev;
+  int moved = 0;
+  uint enqtime;
+
+  // From the tail: those have the longest to wait at src.
+  for(p = src->rq.tail[level]; p && moved < n; p = prev){
+    prev = p->rqprev;
+    if(!cpu_allowed(p, c))
+      continue;
+    if(c->balfail < BALANCE_TRIES && cache_hot(p)){
+      c->rq.nhot++;
       continue;
-    rank = p->priority * p->priority_ratio + p->arrivaltime * p->arrivaltime_ratio + p->execcycle * p->execcycle_ratio;
-    if(rank < min_rank)
-    {
-      final = p;
-      min_rank = rank;
     }
+    enqtime = p->enqtime;
+    dequeue_proc(p);
+    requeue_proc(c, p, enqtime);
+    moved++;
   }
-  return final;
+  return moved;
 }
 
-void agging()
+static void
+balance(struct cpu *c)
 {
-  struct proc *p;
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state != RUNNABLE)
+  struct cpu *src;
+  int level, n, moved = 0;
+  uint nhot = c->rq.nhot;
+
+  c->rq.nbalance++;
+  for(level = 1; level <= NLEVEL; level++){
+    // Read the counts without locks to find a candidate,
+    // then check again once it is locked.
+    if((src = busiest_cpu(c, level)) == 0)
       continue;
-    if (p->wait >= 8000)
-    {
-        p->level = 1;
-        p->wait = 0;
-    }
+    if(src->rq.count[level] - c->rq.count[level] < 2)
+      continue;
+    lock_two(c, src);
+    n = (src->rq.count[level] - c->rq.count[level]) / 2;
+    if(n > NPULL)
+      n = NPULL;
+    if(n > 0)
+      moved += pull(c, src, level, n);
+    release(&src->rq.lock);
+    release(&c->rq.lock);
   }
+  c->rq.npull += moved;
+  if(moved == 0 && c->rq.nhot != nhot)
+    c->balfail++;
+  else
+    c->balfail = 0;
 }
 
-void waiting()
+// Set how often cpus balance their load and how long a process
+// stays cache hot after it stops running.  Negative arguments
+// leave a setting alone, and an interval of 0 turns balancing
+// off.  Returns the old interval.
+int
+set_balance(int interval, int hot)
+{
+  int old = balance_ticks;
+
+  if(interval >= 0)
+    balance_ticks = interval;
+  if(hot >= 0)
+    hot_ticks = hot;
+  return old;
+}
+
+// Choose the next process for cpu c and take it off its ready queue.
+// Levels are served in order, from real time level 0 down, so a cpu
+// with only lower-level work of its own steals higher-level work
+// from the busiest other cpu before running its own.  Within a
+// level the level's policy picks the process, passing over any
+// whose affinity rules out c when stealing.  Takes one queue lock
+// at a time; the process returned is on no queue and is not yet
+// locked.
+static struct proc*
+pick_next(struct cpu *c)
 {
+  static struct proc* (*policy[])(struct runq*) = {
+  [0] earliest_deadline,
+  [1] round_robin,
+  [2] level2_policy,
+  [3] best_job_first,
+  [4] completely_fair,
+  };
+  struct cpu *src;
   struct proc *p;
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if(p->state != RUNNABLE)
+  int level;
+
+  for(level = 0; level <= NLEVEL; level++){
+    src = c;
+    // Real time processes are only run on their own cpu.
+    if(c->rq.count[level] == 0 &&
+       (level == 0 || (src = busiest_cpu(c, level)) == 0))
+      continue;
+    acquire(&src->rq.lock);
+    p = policy[level](&src->rq);
+    if(p && src != c && !cpu_allowed(p, c))
+      p = first_allowed(&src->rq, level, c);
+    if(p){
+      if(level == 4)
+        fair_advance(&src->rq);
+      dequeue_proc(p);
+      if(level == 2)
+        stride_charge(&src->rq, p);
+    }
+    release(&src->rq.lock);
+    if(p == 0)
       continue;
-    p->wait++;
+    if(src != c)
+      c->rq.nsteal++;
+    return p;
   }
+  return 0;
 }
 //PAGEBREAK: 42
 // Per-CPU process scheduler.
@@ -451,6 +1815,7 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  uint t0;
   c->proc = 0;
 
   for(;;)
@@ -458,38 +1823,53 @@ scheduler(void)
     // Enable interrupts on this processor.
     sti();
 
-    // Loop over process table looking for process to run.
-    acquire(&ptable.lock);
-
-    p = round_robin();
-
-    if(p == 0)
-      p = get_lottery();
-
-    if(p == 0)
-      p = best_job_first();
+    // A process handed this cpu by yield_to() runs next;
+    // it is already off its ready queue.
+    if((p = c->next) != 0){
+      c->next = 0;
+      c->rq.nhandoff++;
+    } else {
+      // Halt while nothing is queued anywhere.
+      if(!work_queued(c)){
+        idle(c);
+        continue;
+      }
+      t0 = rdtsc();
+      if((p = pick_next(c)) != 0){
+        c->rq.ndecide++;
+        c->rq.decidecycles += rdtsc() - t0;
+      }
+    }
 
     if(p != 0)
     {
+      // If p just yielded on another cpu, this waits until
+      // that cpu has switched away from it.
+      acquire(&p->lock);
       p->cycle++;
+      p->slice = p->level == 0 ? p->budget : quantum[p->level];
+      if(p->lastcpu != c)
+        p->nmigrate++;
+      p->lastcpu = c;
+      c->rq.nswitch++;
       c->proc = p;
       switchuvm(p);
 
       p->state = RUNNING;
-      p -> execcycle += 0.1;
+      p->execcycle += BJF_SCALE / 10;
+      bjf_update(p);
 
-      waiting();
-      p->wait = 0;
-      agging();
+      p->runstart = rdtsc();
       swtch(&(c->scheduler), p->context);
       switchkvm();
+      p->lastrun = ticks;
       c->proc = 0;
+      release(&p->lock);
     }
-    release(&ptable.lock);
   }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only p->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
@@ -502,14 +1882,21 @@ sched(void)
   int intena;
   struct proc *p = myproc();
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&p->lock))
+    panic("sched p->lock");
   if(mycpu()->ncli != 1)
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
   if(readeflags()&FL_IF)
     panic("sched interruptible");
+  // yield() has queued p already, so it charged p itself.
+  // A real time job ends when its process blocks.
+  if(p->state != RUNNABLE){
+    fair_charge(p);
+    if(p->level == 0)
+      edf_job_end(p);
+  }
   intena = mycpu()->intena;
   swtch(&p->context, mycpu()->scheduler);
   mycpu()->intena = intena;
@@ -519,11 +1906,67 @@ sched(void)
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
-  myproc()->cpu_time = ticks;
+  struct proc *p = myproc();
+  struct cpu *c;
+
+  acquire(&p->lock);  //DOC: yieldlock
+  // No need to kick anyone unless we are leaving this cpu:
+  // it is about to schedule.
+  c = home_cpu(p);
+  fair_charge(p);
+  p->state = RUNNABLE;
+  acquire(&c->rq.lock);
+  enqueue_proc(c, p);
+  release(&c->rq.lock);
+  if(c != p->lastcpu)
+    kick_cpu(c, p);
+  p->cpu_time = ticks;
   sched();
-  release(&ptable.lock);
+  release(&p->lock);
+}
+
+// Give the cpu straight to pid, which must be waiting to run,
+// allowed on this cpu and, at level 0, not throttled, with no
+// process waiting here at a higher level.  Used by one end of a
+// producer-consumer pair to run the other as soon as it has woken
+// it, instead of going on until the next tick and leaving the
+// choice to the policy.  Returns 0 once pid has run and the caller
+// has been scheduled again.
+int
+yield_to(int pid)
+{
+  struct proc *p;
+  struct cpu *c, *rc;
+  int level, err = 0;
+
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  pushcli();
+  c = mycpu();
+  rc = lock_queue(p);
+  if(rc == 0 || p->state != RUNNABLE || c->next != 0 ||
+     (p->level == 0 ? p->rtcpu != c : !cpu_allowed(p, c)))
+    err = ESCHED_AGAIN;
+  // A throttled real time process waits for its next period.
+  if(p->level == 0 && p->budget <= 0)
+    err = ESCHED_AGAIN;
+  // Don't jump the queue of a higher level.
+  for(level = 0; err == 0 && level < p->level; level++)
+    if(c->rq.count[level] > 0)
+      err = ESCHED_AGAIN;
+  if(err == 0){
+    dequeue_proc(p);
+    if(p->level == 2)
+      stride_charge(&rc->rq, p);
+    c->next = p;
+  }
+  unlock_queue(rc);
+  release(&p->lock);
+  popcli();
+  if(err)
+    return err;
+  yield();
+  return 0;
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -532,8 +1975,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding p->lock from scheduler.
+  release(&myproc()->lock);
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -547,12 +1990,91 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
+//PAGEBREAK: 30
+// Wait channels.
+// Sleepers are kept on a hash table of wait queues keyed by
+// channel address, so wakeup() only looks at processes sleeping
+// on a channel that hashes to the same queue.  A process is on a
+// queue exactly when p->chan is non-zero, and p->chan changes only
+// with both the queue's lock and p->lock held.  A queue's lock is
+// taken before p->lock.
+// Each queue also counts wakeups for a few of the channels that
+// hash to it, giving the slot of the least woken one to a new
+// channel, so that one-off channels such as a waiter's own do not
+// crowd out busy ones.  A wakeup is spurious if the process sleeps
+// on the same channel again before its system call returns, as
+// when many sleepers race for one resource.
+
+#define WAITQ_SHIFT 6
+#define NWAITQ (1<<WAITQ_SHIFT)
+#define WAITQ_STATS (NCHANSTAT/NWAITQ)  // channels counted per queue
+
+struct waitq {
+  struct spinlock lock;
+  struct proc *head;
+  struct chanstat stat[WAITQ_STATS];
+};
+
+static struct waitq waitq[NWAITQ];
+
+static void
+waitq_init(void)
+{
+  struct waitq *wq;
+
+  for(wq = waitq; wq < waitq+NWAITQ; wq++)
+    initlock(&wq->lock, "waitq");
+}
+
+static struct waitq*
+waitq_of(void *chan)
+{
+  // Multiplicative hashing; the top bits are the best mixed.
+  return &waitq[((uint)chan * 2654435761U) >> (32 - WAITQ_SHIFT)];
+}
+
+static void
+waitq_remove(struct waitq *wq, struct proc *p)
+{
+  if(p->wqprev)
+    p->wqprev->wqnext = p->wqnext;
+  else
+    wq->head = p->wqnext;
+  if(p->wqnext)
+    p->wqnext->wqprev = p->wqprev;
+  p->wqnext = p->wqprev = 0;
+  p->chan = 0;
+}
+
+// The counters for chan.  If it has none and claim is set, take
+// over a free slot or else that of the least woken channel;
+// otherwise return 0.  Caller must hold wq->lock.
+static struct chanstat*
+chan_stat(struct waitq *wq, void *chan, int claim)
+{
+  struct chanstat *s, *least = wq->stat;
+
+  for(s = wq->stat; s < wq->stat+WAITQ_STATS; s++){
+    if(s->chan == (uint)chan)
+      return s;
+    if(s->chan == 0 || (least->chan != 0 && s->nwakeup < least->nwakeup))
+      least = s;
+  }
+  if(!claim)
+    return 0;
+  memset(least, 0, sizeof(*least));
+  least->chan = (uint)chan;
+  return least;
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct waitq *wq;
+  struct chanstat *s;
   
   if(p == 0)
     panic("sleep");
@@ -560,52 +2082,148 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
+  // Must acquire p->lock in order to
   // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
-  // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
-  // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
-  // Go to sleep.
+  // Queue up before releasing lk: a wakeup
+  // issued under lk then either comes first or
+  // finds us on chan's queue, and it cannot make
+  // us RUNNABLE until sched() lets go of p->lock.
+  wq = waitq_of(chan);
+  acquire(&wq->lock);
+  acquire(&p->lock);  //DOC: sleeplock1
+  if(p->wokechan == chan && (s = chan_stat(wq, chan, 0)) != 0)
+    s->nspurious++;
   p->chan = chan;
+  p->wqprev = 0;
+  p->wqnext = wq->head;
+  if(wq->head)
+    wq->head->wqprev = p;
+  wq->head = p;
   p->state = SLEEPING;
+  release(&wq->lock);
+  release(lk);
 
   sched();
 
-  // Tidy up.
-  p->chan = 0;
+  // Tidy up.  wakeup() takes us off the queue, but
+  // kill() leaves that to us.
+  if(p->chan){
+    release(&p->lock);
+    acquire(&wq->lock);
+    acquire(&p->lock);
+    if(p->chan)
+      waitq_remove(wq, p);
+    release(&wq->lock);
+  }
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  release(&p->lock);  //DOC: sleeplock2
+  acquire(lk);
 }
 
 //PAGEBREAK!
 // Wake up all processes sleeping on chan.
-// The ptable lock must be held.
-static void
-wakeup1(void *chan)
+// Callers hold the lock the sleepers passed to sleep(),
+// so none can be between checking its condition and
+// joining the queue.
+void
+wakeup(void *chan)
 {
-  struct proc *p;
+  struct waitq *wq = waitq_of(chan);
+  struct proc *p, *next;
+  struct chanstat *s;
+  int n = 0;
+
+  acquire(&wq->lock);
+  for(p = wq->head; p; p = next){
+    next = p->wqnext;
+    if(p->chan != chan)
+      continue;
+    acquire(&p->lock);
+    waitq_remove(wq, p);
+    if(p->state == SLEEPING){
+      p->wokechan = chan;
+      make_runnable(p);
+      n++;
+    }
+    release(&p->lock);
+  }
+  if(n > 0 && (s = chan_stat(wq, chan, 1)) != 0){
+    s->nwakeup++;
+    s->nwoken += n;
+  }
+  release(&wq->lock);
+}
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-    if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+// Copy the counters of up to n channels to st.
+// Returns the number copied.
+int
+getchanstat(struct chanstat *st, int n)
+{
+  struct waitq *wq;
+  struct chanstat *s;
+  int i = 0;
+
+  for(wq = waitq; wq < waitq+NWAITQ; wq++){
+    acquire(&wq->lock);
+    for(s = wq->stat; s < wq->stat+WAITQ_STATS && i < n; s++)
+      if(s->chan)
+        st[i++] = *s;
+    release(&wq->lock);
+  }
+  return i;
 }
 
-// Wake up all processes sleeping on chan.
+//PAGEBREAK: 20
+// Timed sleep.
+// Processes in sleep_ticks() are kept on a heap ordered by
+// deadline, so each clock tick looks only at the earliest one
+// and a sleeper is woken once, when its time is up.  Each
+// sleeps on its own deadline, so no one else wakes with it.
+// The heap is protected by tickslock.  Deadlines are compared
+// with wrap-around, in whatever unit the clock counts.
+static int
+deadline_before(struct proc *a, struct proc *b)
+{
+  return (int)(a->deadline - b->deadline) < 0;
+}
+
+static struct procheap sleepers = {
+  .kind = HEAP_TIMER,
+  .before = deadline_before,
+};
+
+// Sleep for n clock ticks.  Returns -1 if killed meanwhile.
+int
+sleep_ticks(int n)
+{
+  struct proc *p = myproc();
+
+  if(n <= 0)
+    return 0;
+  acquire(&tickslock);
+  p->deadline = ticks + n;
+  heap_push(&sleepers, p);
+  while(p->hidx[HEAP_TIMER] >= 0 && !p->killed)
+    sleep(&p->deadline, &tickslock);
+  if(p->hidx[HEAP_TIMER] >= 0)
+    heap_remove(&sleepers, p);
+  release(&tickslock);
+  return p->killed ? -1 : 0;
+}
+
+// Wake the sleepers whose deadline has come.
+// Caller must hold tickslock.
 void
-wakeup(void *chan)
+expire_sleepers(uint now)
 {
-  acquire(&ptable.lock);
-  wakeup1(chan);
-  release(&ptable.lock);
+  struct proc *p;
+
+  while(sleepers.n > 0 && (int)(now - sleepers.a[0]->deadline) >= 0){
+    p = sleepers.a[0];
+    heap_remove(&sleepers, p);
+    wakeup(&p->deadline);
+  }
 }
 
 // Kill the process with the given pid.
@@ -616,19 +2234,14 @@ kill(int pid)
 {
   struct proc *p;
 
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
-    }
-  }
-  release(&ptable.lock);
-  return -1;
+  if((p = lock_pid(pid)) == 0)
+    return -1;
+  p->killed = 1;
+  // Wake process from sleep if necessary.
+  if(p->state == SLEEPING)
+    make_runnable(p);
+  release(&p->lock);
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -651,9 +2264,7 @@ procdump(void)
   char *state;
   uint pc[10];
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == UNUSED)
-      continue;
+  for(p = ptable.live; p; p = p->livenext){
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
       state = states[p->state];
     else
@@ -697,6 +2308,8 @@ int callers[SYSCALL_NUM][PIDS_NUM]={0};
 void
 add_this_pid(int syscall_number, int pid)
 {
+  if(syscall_number >= SYSCALL_NUM || callers[syscall_number][SIZE] >= SIZE)
+    return;
   callers[syscall_number][callers[syscall_number][SIZE]] = pid;
   callers[syscall_number][SIZE]++;
 }
@@ -715,6 +2328,8 @@ print_all_pids(int syscall_number, int size)
 int
 get_callers(int syscall_number)
 {
+  if(syscall_number < 0 || syscall_number >= SYSCALL_NUM)
+    return -1;
   int size = callers[syscall_number][SIZE];
   if(size == 0)
   {
@@ -732,65 +2347,82 @@ int
 change_process_queue(int pid, int dest_queue)
 {
   struct proc *p;
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid)
-    {
-      p->wait = 0;
-      p->level = dest_queue;
-      release(&ptable.lock);
-      return 0;
-    }
-  }
-  release(&ptable.lock);
-  return -1;
+  struct cpu *c;
+  if(dest_queue < 1 || dest_queue > NLEVEL)
+    return ESCHED_ARG;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  c = lock_queue(p);
+  if(p->level == 0)
+    rt_unreserve(p);
+  set_level(p, dest_queue);
+  unlock_queue(c);
+  release(&p->lock);
+  return 0;
 }
 
 int
 lottery_ticket(int pid, int ticket)
 {
   struct proc* p;
-  acquire(&ptable.lock);
-  for (p = ptable.proc; p< &ptable.proc[NPROC]; p++)
-  {
-    if(p->pid == pid)
-    {
-      p->ticket = ticket;
-      release(&ptable.lock);
-      return 0;
-    }
-  }
-  release(&ptable.lock);
-  return -1;
+  struct cpu *c;
+  if(ticket < 1)
+    return ESCHED_ARG;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  c = lock_queue(p);
+  if(c && p->level == 2)
+    ticket_add(&c->rq, p, ticket - p->ticket);
+  p->ticket = ticket;
+  unlock_queue(c);
+  release(&p->lock);
+  return 0;
 }
 
-void
+int
 BJF_parameter_process(int pid, int priority_ratio, int arrivaltime_ratio, int execcycle_ratio)
 {
   struct proc* p;
-  acquire(&ptable.lock);
-  for (p = ptable.proc; p< &ptable.proc[NPROC]; p++)
-  {
-    if(p->pid == pid)
-    {
-      p->priority_ratio = (float)priority_ratio;
-      p->arrivaltime_ratio = (float)arrivaltime_ratio;
-      p->execcycle_ratio = (float)execcycle_ratio;
-    }
-  }
-  release(&ptable.lock);
+  struct cpu *c;
+  if(priority_ratio < 0 || arrivaltime_ratio < 0 || execcycle_ratio < 0)
+    return ESCHED_ARG;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  c = lock_queue(p);
+  p->priority_ratio = priority_ratio;
+  p->arrivaltime_ratio = arrivaltime_ratio;
+  p->execcycle_ratio = execcycle_ratio;
+  bjf_update(p);
+  if(c && p->level == 3)
+    heap_fix(&c->rq.bjf, p);
+  unlock_queue(c);
+  release(&p->lock);
+  return 0;
 }
 
-void
+int
 BJF_parameter_kernel(int priority_ratio, int arrivaltime_ratio, int execcycle_ratio)
 {
   struct proc* p;
-  for (p = ptable.proc; p< &ptable.proc[NPROC]; p++)
+  struct cpu *c;
+  if(priority_ratio < 0 || arrivaltime_ratio < 0 || execcycle_ratio < 0)
+    return -1;
+  acquire(&ptable.lock);
+  for (p = ptable.live; p; p = p->livenext)
   {
-    p->priority_ratio = (float)priority_ratio;
-    p->arrivaltime_ratio = (float)arrivaltime_ratio;
-    p->execcycle_ratio = (float)execcycle_ratio;
+    acquire(&p->lock);
+    c = lock_queue(p);
+    p->priority_ratio = priority_ratio;
+    p->arrivaltime_ratio = arrivaltime_ratio;
+    p->execcycle_ratio = execcycle_ratio;
+    bjf_update(p);
+    if(c && p->level == 3)
+      heap_fix(&c->rq.bjf, p);
+    unlock_queue(c);
+    release(&p->lock);
   }
+  release(&ptable.lock);
+  return 0;
 }
 
 void print_space(int used_length, int total_space)
@@ -850,14 +2482,14 @@ void print_information()
   int x = 17;
   cprintf("name            pid    state    queue-level    arrivaltime    ticket    P_R    A_R    E_R    rank    cycle\n");
   cprintf("--------------------------------------------------------------------------------------------------------------\n");
-  //acquire(&ptable.lock);
-  for (p = ptable.proc; p< &ptable.proc[NPROC]; p++)
+  acquire(&ptable.lock);
+  for (p = ptable.live; p; p = p->livenext)
   {
     x = 17;
     if(strlen(p->name) == 0)
       continue;
 
-    int rank = (int) p->priority * p->priority_ratio + p->arrivaltime * p->arrivaltime_ratio + p->execcycle * p->execcycle_ratio;
+    int rank = (p->priority * p->priority_ratio + p->execcycle * p->execcycle_ratio) / BJF_SCALE + p->arrivaltime * p->arrivaltime_ratio;
     char* state = states[p->state];
 
 
@@ -887,16 +2519,16 @@ void print_information()
     l = nDigits(p->ticket);
     print_space(l,10);
 
-    cprintf("%d", (int) p->priority_ratio);
-    l = nDigits((int)p->priority_ratio);
+    cprintf("%d", p->priority_ratio);
+    l = nDigits(p->priority_ratio);
     print_space(l,7);
 
-    cprintf("%d", (int) p->arrivaltime_ratio);
-    l = nDigits((int)p->arrivaltime_ratio);
+    cprintf("%d", p->arrivaltime_ratio);
+    l = nDigits(p->arrivaltime_ratio);
     print_space(l,7);
 
-    cprintf("%d", (int) p->execcycle_ratio);
-    l = nDigits((int)p->execcycle_ratio);
+    cprintf("%d", p->execcycle_ratio);
+    l = nDigits(p->execcycle_ratio);
     print_space(l,7);
 
     cprintf("%d", rank);
@@ -906,66 +2538,211 @@ void print_information()
     cprintf("%d\n", p->cycle);
 
   }
-  //release(&ptable.lock);
+  release(&ptable.lock);
 }
 
-typedef struct
+int
+getschedstat(struct schedstat *st)
 {
-  int value;
-  int last_index;
-  struct proc *queue[NPROC];
-  struct spinlock lock;
-} Semaphore;
-
-Semaphore semaphore[5];
+  struct cpu *c;
+  struct cpustat *cs;
+
+  // The counters are statistics; read them without locks.
+  st->ncpu = ncpu;
+  st->ticks = ticks;
+  st->balanceticks = balance_ticks;
+  st->hotticks = hot_ticks;
+  for(c = cpus; c < cpus+ncpu; c++){
+    cs = &st->cpu[c-cpus];
+    cs->nswitch = c->rq.nswitch;
+    cs->nsteal = c->rq.nsteal;
+    cs->nready = c->rq.nready;
+    cs->ndecide = c->rq.ndecide;
+    cs->decidecycles = c->rq.decidecycles;
+    cs->idleticks = c->idleticks;
+    cs->kstackhit = c->kstackhit;
+    cs->kstackmiss = c->kstackmiss;
+    cs->load = c->load;
+    cs->nbalance = c->rq.nbalance;
+    cs->npull = c->rq.npull;
+    cs->nhot = c->rq.nhot;
+    cs->rtutil = c->rtutil;
+    cs->nhandoff = c->rq.nhandoff;
+  }
+  return 0;
+}
 
-int sem_init(int i, int v)
+int
+getprocstat(int pid, struct procstat *st)
 {
-  initlock(&semaphore[i].lock, "semaphore");
-  semaphore[i].value = v;
-  semaphore[i].last_index = 0;
+  struct proc *p;
+
+  if(pid == 0)
+    pid = myproc()->pid;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  st->pid = p->pid;
+  st->level = p->level;
+  st->slice = p->slice;
+  st->nrun = p->cycle;
+  st->nticks = p->nticks;
+  st->nmigrate = p->nmigrate;
+  st->affinity = p->affinity & ((1 << ncpu) - 1);
+  st->nice = p->nice;
+  st->njob = p->njob;
+  st->nmiss = p->nmiss;
+  st->noverrun = p->noverrun;
+  release(&p->lock);
   return 0;
 }
 
-int sem_acquire(int i)
+// Restrict pid to the cpus in mask, or only return its mask if
+// mask is 0.  A queued process is moved to an allowed cpu at once;
+// a running one gives up its cpu at the next tick.  A real time
+// process must keep the cpu it is reserved on.  Returns the old
+// mask.
+int
+set_affinity(int pid, int mask)
 {
-  acquire(&semaphore[i].lock);
-  if (semaphore[i].value <= 0)
-  {
-    struct proc *p = myproc();
-    semaphore[i].queue[semaphore[i].last_index] = p;
-    semaphore[i].last_index++;
-    sleep(&semaphore, &semaphore[i].lock);
-  }
-  else
-  {
-    semaphore[i].value--;
+  struct proc *p;
+  struct cpu *c;
+  int old;
+  uint enqtime;
+
+  if(mask != 0 && (mask & ((1 << ncpu) - 1)) == 0)
+    return ESCHED_ARG;
+  if(pid == 0)
+    pid = myproc()->pid;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  old = p->affinity & ((1 << ncpu) - 1);
+  if(mask != 0 && p->level == 0 && p->rtcpu &&
+     (mask & (1 << (p->rtcpu - cpus))) == 0){
+    release(&p->lock);
+    return ESCHED_ARG;
   }
-  if (i != 5)
-  {
-    cprintf("philosopher: %d acquired %d\n", myproc()->pid - 3, i);
+  if(mask != 0){
+    // The queue counts p as work for the cpus it allows.
+    c = lock_queue(p);
+    if(c)
+      count_allowed(&c->rq, p, -1);
+    p->affinity = mask;
+    if(c)
+      count_allowed(&c->rq, p, 1);
+    if(c && !cpu_allowed(p, c)){
+      enqtime = p->enqtime;
+      dequeue_proc(p);
+      release(&c->rq.lock);
+      c = home_cpu(p);
+      acquire(&c->rq.lock);
+      requeue_proc(c, p, enqtime);
+      release(&c->rq.lock);
+      kick_cpu(c, p);
+    } else
+      unlock_queue(c);
+    if(p->state == RUNNING && !cpu_allowed(p, p->lastcpu))
+      p->slice = 0;
   }
-  release(&semaphore[i].lock);
-  return 0;
+  release(&p->lock);
+  return old;
 }
 
-int sem_release(int i)
+// Set the nice value weighting pid's level 4 virtual runtime.
+// Returns the old value.
+int
+set_nice(int pid, int nice)
 {
-  if (semaphore[i].last_index > 0)
-  {
-    semaphore[i].last_index--;
-    struct proc *p = semaphore[i].queue[semaphore[i].last_index];
-    acquire(&ptable.lock);
-    p->state = RUNNABLE;
-    release(&ptable.lock);
+  struct proc *p;
+  int old;
+
+  if(nice < NICE_MIN || nice > NICE_MAX)
+    return ESCHED_ARG;
+  if(pid == 0)
+    pid = myproc()->pid;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  old = p->nice;
+  p->nice = nice;
+  release(&p->lock);
+  return old;
+}
+
+// Reserve runtime ticks of every period for pid at level 0, with
+// each job due deadline ticks after it is released.  A period of
+// 0 cancels the reservation and puts pid back at level 2.
+int
+set_realtime(int pid, int period, int runtime, int deadline)
+{
+  struct proc *p;
+  struct cpu *c, *rc = 0;
+  int density, own = 0;
+
+  if(period != 0 &&
+     (period < 0 || runtime < 1 || runtime > deadline || deadline > period))
+    return ESCHED_ARG;
+  if(pid == 0)
+    pid = myproc()->pid;
+  if((p = lock_pid(pid)) == 0)
+    return ESCHED_PID;
+  if(p->state == ZOMBIE){
+    release(&p->lock);
+    return ESCHED_PID;
   }
-  else
-  {
-    semaphore[i].value++;
+
+  if(period == 0){
+    c = lock_queue(p);
+    if(p->level == 0){
+      rt_unreserve(p);
+      set_level(p, 2);
+    }
+    unlock_queue(c);
+    release(&p->lock);
+    return 0;
   }
-  if (i != 5)
-  {
-    cprintf("philosopher: %d released %d\n", myproc()->pid - 3, i);
+
+  // Admission: first fit, trying p's current cpu first.
+  density = rt_density(runtime, deadline);
+  acquire(&rtlock);
+  if(p->rtcpu){
+    own = rt_density(p->runtime, p->reldeadline);
+    if(cpu_allowed(p, p->rtcpu) &&
+       p->rtcpu->rtutil - own + density <= RT_LIMIT)
+      rc = p->rtcpu;
+  }
+  for(c = cpus; rc == 0 && c < cpus+ncpu; c++)
+    if(cpu_allowed(p, c) && c != p->rtcpu && c->rtutil + density <= RT_LIMIT)
+      rc = c;
+  if(rc == 0){
+    release(&rtlock);
+    release(&p->lock);
+    return ESCHED_BUSY;
+  }
+  if(p->rtcpu)
+    p->rtcpu->rtutil -= own;
+  rc->rtutil += density;
+  release(&rtlock);
+
+  c = lock_queue(p);
+  if(c)
+    dequeue_proc(p);
+  unlock_queue(c);
+  p->level = 0;
+  p->rtcpu = rc;
+  p->period = period;
+  p->runtime = runtime;
+  p->reldeadline = deadline;
+  edf_new_job(p, ticks);
+  if(c){
+    acquire(&rc->rq.lock);
+    enqueue_proc(rc, p);
+    release(&rc->rq.lock);
+    kick_cpu(rc, p);
+  }
+  if(p->state == RUNNING){
+    p->slice = p->budget;
+    if(p->lastcpu != rc)
+      p->slice = 0;
   }
+  release(&p->lock);
   return 0;
 }
@@ -1,3 +1,51 @@
+struct proc;
+
+// Binary min-heap of processes, ordered by before().  A process
+// can be on one heap of each kind at once; p->hidx[kind] is its
+// position in that heap, or -1.
+#define HEAP_RQ    0   // A ready queue heap
+#define HEAP_TIMER 1   // The heap of timed sleepers
+#define NHEAPKIND  2
+
+struct procheap {
+  int n;
+  int kind;
+  int (*before)(struct proc*, struct proc*);
+  struct proc *a[MAXPROC];
+};
+
+// Per-CPU ready queues: a list per level in queueing order, plus
+// deadline heaps for level 0, a ticket tree and stride heap for
+// level 2, a heap for level 3 and a virtual runtime heap for level 4.
+// Protected by lock; the counts may be read without it as a hint
+// of whether there is work.
+struct runq {
+  struct spinlock lock;
+  struct proc *head[NLEVEL+1];
+  struct proc *tail[NLEVEL+1];
+  struct procheap edf;           // Level 0 with budget, earliest deadline first
+  struct procheap throttled;     // Level 0 without, earliest release first
+  struct procheap bjf;           // Level 3, lowest BJF rank first
+  int tickets;                   // Sum of level 2 tickets
+  int tree[MAXPROC+1];           // Fenwick tree of level 2 tickets by slot
+  struct procheap stride;        // Level 2, lowest stride pass first
+  uint vpass;                    // Pass of the last level 2 process run
+  struct procheap fair;          // Level 4, least virtual runtime first
+  uint64 minvruntime;            // Least level 4 virtual runtime run
+  volatile int count[NLEVEL+1];  // Processes waiting at each level
+  volatile int nready;           // Processes waiting at all levels
+  volatile int nallowed[NLEVEL+1][NCPU]; // Those above level 0 that
+                                 //   each cpu may run, by level
+  uint nswitch;                  // Context switches done by this cpu
+  uint nsteal;                   // Processes taken from other cpus
+  uint nbalance;                 // Load balancing runs
+  uint npull;                    // Processes they moved here
+  uint nhot;                     // Ones they left as cache hot
+  uint nhandoff;                 // Processes run by yield_to()
+  uint ndecide;                  // Scheduling decisions made
+  uint decidecycles;             // TSC cycles spent making them
+};
+
 // Per-CPU state
 struct cpu {
   uchar apicid;                // Local APIC ID
@@ -8,6 +56,18 @@ struct cpu {
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
   struct proc *proc;           // The process running on this cpu or null
+  struct proc *next;           // Process handed this cpu by yield_to()
+  struct runq rq;              // Processes ready to run on this cpu
+  uint rng;                    // Lottery random number generator state
+  volatile int idle;           // Halted in idle(), waiting for work
+  uint idleticks;              // Timer ticks spent halted
+  uint load;                   // Decaying average of processes here
+  int rtutil;                  // Level 0 density reserved here, in 1/1000ths
+  int baltick;                 // Ticks since this cpu last balanced
+  int balfail;                 // Runs in a row that only found hot work
+  char *kstackcache[NKSTACKCACHE]; // Freed kernel stacks to reuse
+  int nkstack;                 // Number of stacks in kstackcache
+  uint kstackhit, kstackmiss;  // Stack allocations served or not by it
 };
 
 extern struct cpu cpus[NCPU];
@@ -36,28 +96,64 @@ enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
 struct proc {
+  struct spinlock lock;        // Protects state, chan, killed, pid
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
+  struct vm *vm;               // Address space pgdir belongs to
   char *kstack;                // Bottom of kernel stack for this process
   enum procstate state;        // Process state
   int pid;                     // Process ID
-  struct proc *parent;         // Parent process
+  struct proc *pidnext;        // Next in pid hash chain
+  struct proc *livenext, *liveprev; // Links in the list of live processes
+  int slot;                    // Fixed index of this struct proc
+  struct proc *parent;         // Parent; wait_lock guards it and the next 3
+  struct proc *children;       // Children still running
+  struct proc *zombies;        // Children that have exited
+  struct proc *sibnext, *sibprev; // Links on parent's children or zombies
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
   void *chan;                  // If non-zero, sleeping on chan
+  struct proc *wqnext, *wqprev; // Links in chan's wait queue
+  void *wokechan;              // Channel we were last woken from
   int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[30];               // Process name (debugging)
   int level;                   // Process level
   int ticket;                  // Process Ticket
-  float priority, priority_ratio;
-  float arrivaltime_ratio;
-  float execcycle, execcycle_ratio;
+  int priority, priority_ratio; // BJF parameters; priority and
+  int arrivaltime_ratio;       //   execcycle are in 1/1000ths
+  int execcycle, execcycle_ratio;
+  uint64 rank;                 // BJF rank, in 1/1000ths
   int arrivaltime;
-  int wait;
+  uint enqtime;                // Tick at which we were queued
   int cpu_time;
-  int cycle;
+  int cycle;                   // Times the scheduler has run us
+  int slice;                   // Ticks left of our time slice
+  uint nticks;                 // Timer ticks that found us running
+  struct proc *rqnext, *rqprev; // Links in the ready queue list
+  uint pass;                   // Stride scheduling pass; while not
+                               //   queued, relative to vpass
+  uint64 vruntime;             // Level 4 virtual runtime; while not
+                               //   queued, relative to minvruntime
+  int nice;                    // -20 to 19, weighting vruntime
+  uint runstart;               // TSC when we were last switched to
+  int period, runtime, reldeadline; // Level 0 reservation, in ticks
+  struct cpu *rtcpu;           // Cpu it is reserved on
+  uint release;                // Tick at which our current job began
+  uint absdeadline;            // Tick by which it should be done
+  int budget;                  // Ticks of runtime it has left
+  int jobdone;                 // If non-zero, it blocked or ran out
+  uint njob, nmiss, noverrun;  // Jobs, those done late, those cut off
+  int hidx[NHEAPKIND];         // Index in the heaps we are on
+  uint deadline;               // Tick at which sleep() should end
+  struct cpu *rqcpu;           // Cpu whose ready queue holds us, or null
+  struct cpu *lastcpu;         // Cpu we last ran on
+  uint lastrun;                // Tick at which we last stopped running
+  uint affinity;               // Bit i set if we may run on cpus[i]
+  uint nmigrate;               // Times we were run on another cpu
+  int isthread;                // Made by clone(); wait_lock guards it
+  uint ustack;                 // User stack clone() was given
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -66,7 +162,7 @@ struct proc {
 //   fixed-size stack
 //   expandable heap
 
-#define SYSCALL_NUM 25
+#define SYSCALL_NUM 64  // one row per syscall number
 #define PIDS_NUM 201
 #define SIZE 200
 //201 item maintain the size of the array which is filled;
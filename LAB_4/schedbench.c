@@ -0,0 +1,96 @@
+// Context switch throughput benchmark.
+// Usage: schedbench [pairs] [ticks]
+// Forks pairs of processes that bounce a byte through two pipes,
+// so every round trip costs two context switches, then reports
+// how many switches all cpus did per second.  Run it under
+// "make qemu CPUS=1" up to "CPUS=8" to see how the scheduler scales.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define MAXPAIRS 16
+
+void
+pingpong(int rfd, int wfd, int serve)
+{
+  char c = 0;
+
+  if(serve)
+    write(wfd, &c, 1);
+  for(;;){
+    if(read(rfd, &c, 1) != 1)
+      exit();
+    write(wfd, &c, 1);
+  }
+}
+
+uint
+total_switches(struct schedstat *st)
+{
+  uint n = 0;
+  int i;
+
+  for(i = 0; i < st->ncpu; i++)
+    n += st->cpu[i].nswitch;
+  return n;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pairs, duration;
+  int pids[2*MAXPAIRS], a[2], b[2];
+  struct schedstat st0, st1;
+  uint n, elapsed;
+  int i, k;
+
+  pairs = argnum(argc, argv, 1, 4);
+  duration = argnum(argc, argv, 2, 500);
+  if(pairs < 1 || pairs > MAXPAIRS || duration < 1){
+    printf(2, "usage: schedbench [pairs 1-%d] [ticks]\n", MAXPAIRS);
+    exit();
+  }
+
+  for(i = 0; i < pairs; i++){
+    if(pipe(a) < 0 || pipe(b) < 0){
+      printf(2, "schedbench: pipe failed\n");
+      exit();
+    }
+    for(k = 0; k < 2; k++){
+      if((pids[2*i+k] = fork()) == 0){
+        if(k == 0)
+          pingpong(a[0], b[1], 1);
+        else
+          pingpong(b[0], a[1], 0);
+      }
+    }
+    close(a[0]); close(a[1]);
+    close(b[0]); close(b[1]);
+  }
+
+  getschedstat(&st0);
+  sleep(duration);
+  getschedstat(&st1);
+
+  for(i = 0; i < 2*pairs; i++)
+    if(pids[i] > 0)
+      kill(pids[i]);
+  for(i = 0; i < 2*pairs; i++)
+    wait();
+
+  elapsed = st1.ticks - st0.ticks;
+  if(elapsed == 0)
+    elapsed = 1;
+  n = total_switches(&st1) - total_switches(&st0);
+  printf(1, "cpus %d pairs %d ticks %d: %d switches, %d switches/sec\n",
+         st1.ncpu, pairs, elapsed, n, persec(n, elapsed));
+  for(i = 0; i < st1.ncpu; i++)
+    printf(1, "  cpu%d: %d switches, %d stolen, %d ticks idle\n", i,
+           st1.cpu[i].nswitch - st0.cpu[i].nswitch,
+           st1.cpu[i].nsteal - st0.cpu[i].nsteal,
+           st1.cpu[i].idleticks - st0.cpu[i].idleticks);
+  exit();
+}
@@ -0,0 +1,71 @@
+// Errors returned by change_process_queue(), lottery_ticket(),
+// BJF_parameter_process(), set_affinity(), set_nice(),
+// set_realtime() and yield_to().
+#define ESCHED_ARG -1   // Parameter out of range
+#define ESCHED_PID -2   // No live process has that pid
+#define ESCHED_BUSY -3  // No allowed cpu has the real time capacity
+#define ESCHED_AGAIN -4 // yield_to() target is not waiting to run here
+
+// Range of set_nice() values; 0 is the default.
+#define NICE_MIN -20
+#define NICE_MAX 19
+
+// Level 2 scheduling modes for set_lottery_mode().
+#define L2_LOTTERY 0
+#define L2_STRIDE  1
+
+// Scheduler statistics, filled in by getschedstat().
+
+struct cpustat {
+  uint nswitch;      // Context switches done by this cpu
+  uint nsteal;       // Processes taken from other cpus' queues
+  int nready;        // Processes waiting in this cpu's ready queue
+  uint ndecide;      // Scheduling decisions made
+  uint decidecycles; // TSC cycles spent making them (wraps)
+  uint idleticks;    // Timer ticks spent halted with nothing to run
+  uint kstackhit;    // Kernel stacks reused from this cpu's cache
+  uint kstackmiss;   // Kernel stacks that had to come from kalloc()
+  uint load;         // Running and waiting processes, in hundredths,
+                     // averaged over the last few dozen ticks
+  uint nbalance;     // Load balancing runs
+  uint npull;        // Processes they moved to this cpu
+  uint nhot;         // Processes they left alone as cache hot
+  int rtutil;        // Real time density reserved, in thousandths
+  uint nhandoff;     // Processes run at once by yield_to()
+};
+
+struct schedstat {
+  int ncpu;          // Number of cpus running the scheduler
+  uint ticks;        // Clock ticks since boot
+  int balanceticks;  // Ticks between load balancing runs, 0 if off
+  int hotticks;      // Processes run within this many ticks are hot
+  struct cpustat cpu[NCPU];
+};
+
+// Per-process statistics, filled in by getprocstat().
+
+struct procstat {
+  int pid;
+  int level;         // Ready queue level
+  int slice;         // Ticks left of its current time slice
+  uint nrun;         // Times the scheduler has run it
+  uint nticks;       // Timer ticks that found it running
+  uint nmigrate;     // Runs on a different cpu from the last one
+  uint affinity;     // Cpus it may run on, one bit each
+  int nice;          // Weight of its level 4 virtual runtime
+  uint njob;         // Real time jobs it has finished
+  uint nmiss;        // Those finished after their deadline
+  uint noverrun;     // Those cut off at the end of their budget
+};
+
+// Wait channel statistics, filled in by getchanstat().
+
+#define NCHANSTAT 256   // Most channels counted at once
+
+struct chanstat {
+  uint chan;         // Channel address; look it up in kernel.sym
+  uint nwakeup;      // wakeup() calls that found a sleeper
+  uint nwoken;       // Processes those calls made runnable
+  uint nspurious;    // Woken processes that slept on it again
+                     // within the same system call
+};
@@ -0,0 +1,205 @@
+// Counting semaphores.
+//
+// sem_init() hands out a handle, which any process may use until
+// someone calls sem_free() on it.  The struct behind a handle
+// comes from a kcache the first time the handle is given out and
+// stays with it, like a struct proc with its slot, so a handle is
+// looked up without a table lock.
+//
+// Waiters queue in arrival order, each sleeping on its own
+// channel.  sem_release() hands the unit straight to the first,
+// so no later acquirer can take it first and only that waiter
+// is woken.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "proc.h"
+
+// Lives on the waiting process's kernel stack.
+struct semwaiter {
+  int granted;              // Set when sem_release() gave us the unit
+  struct semwaiter *next;
+};
+
+struct sem {
+  struct spinlock lock;
+  int used;                 // Handed out and not yet freed
+  int value;
+  struct semwaiter *head;   // Waiters, first come first served
+  struct semwaiter *tail;
+};
+
+// The table lock guards the slots and the free stack, and is
+// taken before a semaphore's lock.
+static struct {
+  struct spinlock lock;
+  struct kcache *cache;
+  struct sem *slot[MAXSEM];   // Every struct sem, by handle
+  int nslot;
+  int free[MAXSEM];           // Stack of handles not in use
+  int nfree;
+} semtable;
+
+void
+seminit(void)
+{
+  initlock(&semtable.lock, "semtable");
+  semtable.cache = kcache_create("sem", sizeof(struct sem));
+}
+
+// Return the semaphore with handle h, locked, or 0.
+static struct sem*
+lock_sem(int h)
+{
+  struct sem *s;
+
+  if(h < 0 || h >= MAXSEM || (s = semtable.slot[h]) == 0)
+    return 0;
+  acquire(&s->lock);
+  if(!s->used){
+    release(&s->lock);
+    return 0;
+  }
+  return s;
+}
+
+// Allocate a semaphore with the given value and return its
+// handle, or -1 if there is none left.
+int
+sem_init(int value)
+{
+  struct sem *s;
+  int h;
+
+  if(value < 0)
+    return -1;
+  acquire(&semtable.lock);
+  if(semtable.nfree > 0)
+    h = semtable.free[--semtable.nfree];
+  else if(semtable.nslot < MAXSEM && (s = kcache_alloc(semtable.cache)) != 0){
+    memset(s, 0, sizeof(*s));
+    initlock(&s->lock, "sem");
+    h = semtable.nslot;
+    semtable.slot[semtable.nslot++] = s;
+  } else {
+    release(&semtable.lock);
+    return -1;
+  }
+  s = semtable.slot[h];
+  acquire(&s->lock);
+  s->used = 1;
+  s->value = value;
+  s->head = s->tail = 0;
+  release(&s->lock);
+  release(&semtable.lock);
+  return h;
+}
+
+// Give back handle h.  Fails if anyone is waiting on it.
+int
+sem_free(int h)
+{
+  struct sem *s;
+
+  if((s = lock_sem(h)) == 0)
+    return -1;
+  if(s->head){
+    release(&s->lock);
+    return -1;
+  }
+  s->used = 0;
+  release(&s->lock);
+
+  acquire(&semtable.lock);
+  semtable.free[semtable.nfree++] = h;
+  release(&semtable.lock);
+  return 0;
+}
+
+// Returns 0 once the caller holds a unit, or -1 if h is not
+// a semaphore or the caller was killed while waiting.
+int
+sem_acquire(int h)
+{
+  struct sem *s;
+  struct semwaiter w, *q, *prev;
+
+  if((s = lock_sem(h)) == 0)
+    return -1;
+  // Units are handed to waiters directly, so there is
+  // none left over while anyone waits.
+  if(s->value > 0){
+    s->value--;
+    release(&s->lock);
+    return 0;
+  }
+
+  w.granted = 0;
+  w.next = 0;
+  if(s->tail)
+    s->tail->next = &w;
+  else
+    s->head = &w;
+  s->tail = &w;
+  while(!w.granted && !myproc()->killed)
+    sleep(&w, &s->lock);
+
+  if(!w.granted){
+    // Killed: leave the queue.
+    prev = 0;
+    for(q = s->head; q != &w; q = q->next)
+      prev = q;
+    if(prev)
+      prev->next = w.next;
+    else
+      s->head = w.next;
+    if(s->tail == &w)
+      s->tail = prev;
+    release(&s->lock);
+    return -1;
+  }
+  release(&s->lock);
+  return 0;
+}
+
+// Take a unit if one is free.  Returns 0 if it did, 1 if
+// none was free, or -1 if h is not a semaphore.
+int
+sem_tryacquire(int h)
+{
+  struct sem *s;
+  int r = 1;
+
+  if((s = lock_sem(h)) == 0)
+    return -1;
+  if(s->value > 0){
+    s->value--;
+    r = 0;
+  }
+  release(&s->lock);
+  return r;
+}
+
+// Give a unit to the first waiter, or back to the semaphore.
+int
+sem_release(int h)
+{
+  struct sem *s;
+  struct semwaiter *w;
+
+  if((s = lock_sem(h)) == 0)
+    return -1;
+  if((w = s->head) != 0){
+    s->head = w->next;
+    if(s->head == 0)
+      s->tail = 0;
+    w->granted = 1;
+    wakeup(w);
+  } else
+    s->value++;
+  release(&s->lock);
+  return 0;
+}
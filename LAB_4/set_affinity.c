@@ -0,0 +1,26 @@
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 2 && argc != 3)
+    {
+        printf(2, "usage: set_affinity pid [mask]\n");
+        exit();
+    }
+    int pid = atoi(argv[1]);
+    int mask = argc == 3 ? atoi(argv[2]) : 0;
+    int old = set_affinity(pid, mask);
+    if(old == ESCHED_PID)
+        printf(2, "set_affinity: no process with pid %d\n", pid);
+    else if(old == ESCHED_ARG)
+        printf(2, "set_affinity: mask %d names no running cpu, or leaves out the cpu pid %d is reserved on\n", mask, pid);
+    else if(mask == 0)
+        printf(1, "pid %d affinity %x\n", pid, old);
+    else
+        printf(1, "pid %d affinity %x, was %x\n", pid, mask, old);
+    exit();
+}
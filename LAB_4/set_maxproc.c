@@ -0,0 +1,20 @@
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "user.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 2)
+    {
+        printf(2, "usage: set_maxproc n\n");
+        exit();
+    }
+    int n = atoi(argv[1]);
+    int old = set_maxproc(n);
+    if(old < 0)
+        printf(2, "set_maxproc: n must be 1 to %d\n", MAXPROC);
+    else
+        printf(1, "process limit %d, was %d\n", n, old);
+    exit();
+}
@@ -0,0 +1,25 @@
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 3)
+    {
+        printf(2, "usage: set_nice pid nice\n");
+        exit();
+    }
+    int pid = atoi(argv[1]);
+    // atoi() takes no sign.
+    int nice = argv[2][0] == '-' ? -atoi(argv[2] + 1) : atoi(argv[2]);
+    int old = set_nice(pid, nice);
+    if(old == ESCHED_PID)
+        printf(2, "set_nice: no process with pid %d\n", pid);
+    else if(old == ESCHED_ARG)
+        printf(2, "set_nice: nice must be %d to %d\n", NICE_MIN, NICE_MAX);
+    else
+        printf(1, "pid %d nice %d, was %d\n", pid, nice, old);
+    exit();
+}
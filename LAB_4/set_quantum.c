@@ -0,0 +1,23 @@
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "user.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 2 && argc != 3)
+    {
+        printf(2, "usage: set_quantum level [ticks]\n");
+        exit();
+    }
+    int level = atoi(argv[1]);
+    int ticks = argc == 3 ? atoi(argv[2]) : 0;
+    int old = set_quantum(level, ticks);
+    if(old < 0)
+        printf(2, "set_quantum: level must be 1 to %d and ticks positive\n", NLEVEL);
+    else if(ticks == 0)
+        printf(1, "level %d quantum %d\n", level, old);
+    else
+        printf(1, "level %d quantum %d, was %d\n", level, ticks, old);
+    exit();
+}
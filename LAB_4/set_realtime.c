@@ -0,0 +1,31 @@
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+int main(int argc, char* argv[])
+{
+    if(argc != 3 && argc != 5)
+    {
+        printf(2, "usage: set_realtime pid period [runtime deadline]\n");
+        exit();
+    }
+    int pid = atoi(argv[1]);
+    int period = atoi(argv[2]);
+    int runtime = argc == 5 ? atoi(argv[3]) : 0;
+    int deadline = argc == 5 ? atoi(argv[4]) : 0;
+    int r = set_realtime(pid, period, runtime, deadline);
+    if(r == ESCHED_PID)
+        printf(2, "set_realtime: no process with pid %d\n", pid);
+    else if(r == ESCHED_ARG)
+        printf(2, "set_realtime: need 0 < runtime <= deadline <= period\n");
+    else if(r == ESCHED_BUSY)
+        printf(2, "set_realtime: no cpu has room for %d/%d\n", runtime, deadline);
+    else if(period == 0)
+        printf(1, "pid %d is no longer real time\n", pid);
+    else
+        printf(1, "pid %d runs %d of every %d ticks, due after %d\n",
+               pid, runtime, period, deadline);
+    exit();
+}
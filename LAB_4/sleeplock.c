@@ -6,9 +6,10 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
 #include "sleeplock.h"
+#include "lockstat.h"
 
 void
 initsleeplock(struct sleeplock *lk, char *name)
@@ -17,17 +18,26 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+  lk->class = lockclass(name, LOCKSTAT_SLEEP);
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
+  uint t0 = rdtsc();
+  int contended;
+
   acquire(&lk->lk);
+  contended = lk->locked;
   while (lk->locked) {
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+  if(lk->class){
+    lk->tstart = rdtsc();
+    lockprof_acquired(lk->class, cpuid(), lk->tstart - t0, contended);
+  }
   release(&lk->lk);
 }
 
@@ -35,6 +45,8 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+  if(lk->class)
+    lockprof_released(lk->class, cpuid(), rdtsc() - lk->tstart);
   lk->locked = 0;
   lk->pid = 0;
   wakeup(lk);
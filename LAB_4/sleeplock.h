@@ -2,6 +2,8 @@
 struct sleeplock {
   uint locked;       // Is the lock held?
   struct spinlock lk; // spinlock protecting this sleep lock
+  struct lockclass *class; // Profile it counts into, or 0
+  uint tstart;       // TSC when the holder got it
   
   // For debugging:
   char *name;        // Name of lock.
@@ -6,15 +6,18 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
+#include "lockstat.h"
 
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+  lk->class = lockclass(name, LOCKSTAT_SPIN);
 }
 
 // Acquire the lock.
@@ -24,13 +27,22 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  uint ticket, t0 = 0;
+  int contended = 0;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // The xadd is atomic.  Waiters only read owner, so the cache
+  // line stays shared until release() writes it.
+  if(lk->class)
+    t0 = rdtsc();
+  ticket = xadd(&lk->next, 1);
+  while(lk->owner != ticket){
+    contended = 1;
+    pause();
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -40,6 +52,10 @@ acquire(struct spinlock *lk)
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
   getcallerpcs(&lk, lk->pcs);
+  if(lk->class){
+    lk->tstart = rdtsc();
+    lockprof_acquired(lk->class, lk->cpu - cpus, lk->tstart - t0, contended);
+  }
 }
 
 // Release the lock.
@@ -49,6 +65,8 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+  if(lk->class)
+    lockprof_released(lk->class, lk->cpu - cpus, rdtsc() - lk->tstart);
   lk->pcs[0] = 0;
   lk->cpu = 0;
 
@@ -59,10 +77,10 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  // Let the next ticket in.  Only the holder writes owner,
+  // so this need not be atomic with the read, but the store
+  // itself must be a single instruction.
+  asm volatile("movl %1, %0" : "+m" (lk->owner) : "r" (lk->owner + 1));
 
   popcli();
 }
@@ -91,7 +109,7 @@ holding(struct spinlock *lock)
 {
   int r;
   pushcli();
-  r = lock->locked && lock->cpu == mycpu();
+  r = lock->owner != lock->next && lock->cpu == mycpu();
   popcli();
   return r;
 }
@@ -1,6 +1,11 @@
 // Mutual exclusion lock.
+// A ticket lock: acquire() takes the next ticket and waits until
+// owner reaches it, so cpus get the lock in the order they asked.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  volatile uint next;   // Next ticket to hand out
+  volatile uint owner;  // Ticket of the holder, or of the next one
+  struct lockclass *class; // Profile it counts into, or 0
+  uint tstart;          // TSC when the holder got it
 
   // For debugging:
   char *name;        // Name of lock.
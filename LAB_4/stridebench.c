@@ -0,0 +1,99 @@
+// Lottery vs. stride throughput variance benchmark.
+// Usage: stridebench [windows]
+// Runs three CPU-bound level 2 processes holding 100, 200 and 300
+// tickets, first under lottery and then under stride scheduling,
+// and counts each one's loop iterations in every 100-tick window.
+// For each process it prints the mean per window and the mean
+// absolute deviation from it in per mille of the mean; the lower
+// the deviation, the more predictable the short-term throughput.
+// Run it with CPUS=1, so that the processes compete for one cpu.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "schedstat.h"
+#include "user.h"
+
+#define NCHILD 3
+#define WINDOW 100
+#define MAXWIN 32
+
+int tickets[NCHILD] = { 100, 200, 300 };
+
+void
+worker(int startfd, int resultfd, int id, int nwin)
+{
+  int counts[MAXWIN];
+  int w, t0, count;
+  char c;
+
+  read(startfd, &c, 1);
+  t0 = uptime();
+  for(w = 0; w < nwin; w++){
+    count = 0;
+    while(uptime() - t0 < (w+1) * WINDOW)
+      count++;
+    counts[w] = count;
+  }
+  write(resultfd, &id, sizeof(id));
+  write(resultfd, counts, nwin * sizeof(counts[0]));
+  exit();
+}
+
+void
+run(char *name, int mode, int nwin)
+{
+  int start[2], result[2];
+  int pids[NCHILD], counts[NCHILD][MAXWIN];
+  int i, w, id, mean, dev;
+  char go[NCHILD];
+
+  if(pipe(start) < 0 || pipe(result) < 0){
+    printf(2, "stridebench: pipe failed\n");
+    exit();
+  }
+  set_lottery_mode(mode);
+  for(i = 0; i < NCHILD; i++){
+    if((pids[i] = fork()) == 0)
+      worker(start[0], result[1], i, nwin);
+    lottery_ticket(pids[i], tickets[i]);
+  }
+  memset(go, 0, sizeof(go));
+  write(start[1], go, NCHILD);
+  for(i = 0; i < NCHILD; i++){
+    read(result[0], &id, sizeof(id));
+    read(result[0], counts[id], nwin * sizeof(counts[id][0]));
+  }
+  for(i = 0; i < NCHILD; i++)
+    wait();
+  close(start[0]); close(start[1]);
+  close(result[0]); close(result[1]);
+
+  printf(1, "%s:\n", name);
+  for(i = 0; i < NCHILD; i++){
+    mean = dev = 0;
+    for(w = 0; w < nwin; w++)
+      mean += counts[i][w] / nwin;
+    for(w = 0; w < nwin; w++)
+      dev += (counts[i][w] > mean ? counts[i][w] - mean : mean - counts[i][w]) / nwin;
+    printf(1, "  %d tickets: mean %d/window, deviation %d/1000\n",
+           tickets[i], mean, dev / (mean / 1000 + 1));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nwin = 10;
+
+  if(argc > 1)
+    nwin = atoi(argv[1]);
+  if(nwin < 1 || nwin > MAXWIN){
+    printf(2, "usage: stridebench [windows 1-%d]\n", MAXWIN);
+    exit();
+  }
+  run("lottery", L2_LOTTERY, nwin);
+  run("stride", L2_STRIDE, nwin);
+  set_lottery_mode(L2_LOTTERY);
+  exit();
+}
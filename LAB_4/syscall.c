@@ -3,6 +3,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
@@ -115,6 +116,26 @@ extern int sys_print_information(void);
 extern int sys_sem_init(void);
 extern int sys_sem_acquire(void);
 extern int sys_sem_release(void);
+extern int sys_getschedstat(void);
+extern int sys_lottery_seed(void);
+extern int sys_set_lottery_mode(void);
+extern int sys_set_aging(void);
+extern int sys_getchanstat(void);
+extern int sys_set_maxproc(void);
+extern int sys_set_quantum(void);
+extern int sys_getprocstat(void);
+extern int sys_set_affinity(void);
+extern int sys_set_balance(void);
+extern int sys_set_nice(void);
+extern int sys_set_realtime(void);
+extern int sys_yield_to(void);
+extern int sys_sem_tryacquire(void);
+extern int sys_sem_free(void);
+extern int sys_futex(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_lockstress(void);
+extern int sys_getlockstat(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -150,6 +171,26 @@ static int (*syscalls[])(void) = {
 [SYS_sem_init] sys_sem_init,
 [SYS_sem_acquire] sys_sem_acquire,
 [SYS_sem_release] sys_sem_release,
+[SYS_getschedstat] sys_getschedstat,
+[SYS_lottery_seed] sys_lottery_seed,
+[SYS_set_lottery_mode] sys_set_lottery_mode,
+[SYS_set_aging] sys_set_aging,
+[SYS_getchanstat] sys_getchanstat,
+[SYS_set_maxproc] sys_set_maxproc,
+[SYS_set_quantum] sys_set_quantum,
+[SYS_getprocstat] sys_getprocstat,
+[SYS_set_affinity] sys_set_affinity,
+[SYS_set_balance] sys_set_balance,
+[SYS_set_nice] sys_set_nice,
+[SYS_set_realtime] sys_set_realtime,
+[SYS_yield_to] sys_yield_to,
+[SYS_sem_tryacquire] sys_sem_tryacquire,
+[SYS_sem_free] sys_sem_free,
+[SYS_futex] sys_futex,
+[SYS_clone] sys_clone,
+[SYS_join] sys_join,
+[SYS_lockstress] sys_lockstress,
+[SYS_getlockstat] sys_getlockstat,
 };
 
 void
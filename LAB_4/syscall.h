@@ -32,3 +32,23 @@
 #define SYS_sem_acquire 31
 #define SYS_sem_release 32
 #define SYS_sem_init 33
+#define SYS_getschedstat 34
+#define SYS_lottery_seed 35
+#define SYS_set_lottery_mode 36
+#define SYS_set_aging 37
+#define SYS_getchanstat 38
+#define SYS_set_maxproc 39
+#define SYS_set_quantum 40
+#define SYS_getprocstat 41
+#define SYS_set_affinity 42
+#define SYS_set_balance 43
+#define SYS_set_nice 44
+#define SYS_set_realtime 45
+#define SYS_yield_to 46
+#define SYS_sem_tryacquire 47
+#define SYS_sem_free 48
+#define SYS_futex 49
+#define SYS_clone 50
+#define SYS_join 51
+#define SYS_lockstress 52
+#define SYS_getlockstat 53
@@ -5,7 +5,10 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
+#include "schedstat.h"
+#include "lockstat.h"
 
 int
 sys_fork(void)
@@ -50,8 +53,7 @@ sys_sbrk(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  if((addr = growproc(n)) < 0)
     return -1;
   return addr;
 }
@@ -60,21 +62,10 @@ int
 sys_sleep(void)
 {
   int n;
-  uint ticks0;
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
-  ticks0 = ticks;
-  while(ticks - ticks0 < n){
-    if(myproc()->killed){
-      release(&tickslock);
-      return -1;
-    }
-    sleep(&ticks, &tickslock);
-  }
-  release(&tickslock);
-  return 0;
+  return sleep_ticks(n);
 }
 
 // return how many clock tick interrupts have occurred
@@ -142,8 +133,7 @@ sys_BJF_parameter_process(void)
       || argint(2, &arrivaltime_ratio) < 0 || argint(3, &execcycle_ratio) < 0)
     return -1;
 
-  BJF_parameter_process(pid, priority_ratio, arrivaltime_ratio, execcycle_ratio);
-  return 0;
+  return BJF_parameter_process(pid, priority_ratio, arrivaltime_ratio, execcycle_ratio);
 }
 
 int
@@ -153,8 +143,7 @@ sys_BJF_parameter_kernel(void)
   if(argint(0, &priority_ratio) < 0 || argint(1, &arrivaltime_ratio) < 0 || argint(2, &execcycle_ratio) < 0)
     return -1;
 
-  BJF_parameter_kernel(priority_ratio, arrivaltime_ratio, execcycle_ratio);
-  return 0;
+  return BJF_parameter_kernel(priority_ratio, arrivaltime_ratio, execcycle_ratio);
 }
 
 int
@@ -167,11 +156,11 @@ sys_print_information(void)
 int 
 sys_sem_init(void)
 {
-  int i, v;
-  if (argint(0, &i) < 0 || argint(1, &v) < 0)
+  int v;
+  if (argint(0, &v) < 0)
     return -1;
 
-  return sem_init(i, v);
+  return sem_init(v);
 }
 
 int 
@@ -193,3 +182,218 @@ sys_sem_release(void)
     
   return sem_release(i);
 }
+
+int
+sys_getschedstat(void)
+{
+  struct schedstat *st;
+  if(argptr(0, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+
+  return getschedstat(st);
+}
+
+int
+sys_lottery_seed(void)
+{
+  int seed;
+  if(argint(0, &seed) < 0)
+    return -1;
+
+  lottery_seed(seed);
+  return 0;
+}
+
+int
+sys_set_lottery_mode(void)
+{
+  int mode;
+  if(argint(0, &mode) < 0)
+    return -1;
+
+  return set_lottery_mode(mode);
+}
+
+int
+sys_set_aging(void)
+{
+  int limit;
+  if(argint(0, &limit) < 0)
+    return -1;
+
+  return set_aging(limit);
+}
+
+int
+sys_getchanstat(void)
+{
+  struct chanstat *st;
+  int n;
+  if(argint(1, &n) < 0 || n < 0)
+    return -1;
+  if(n > NCHANSTAT)
+    n = NCHANSTAT;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+
+  return getchanstat(st, n);
+}
+
+int
+sys_set_maxproc(void)
+{
+  int n;
+  if(argint(0, &n) < 0)
+    return -1;
+
+  return set_maxproc(n);
+}
+
+int
+sys_set_quantum(void)
+{
+  int level, ticks;
+  if(argint(0, &level) < 0 || argint(1, &ticks) < 0)
+    return -1;
+
+  return set_quantum(level, ticks);
+}
+
+int
+sys_getprocstat(void)
+{
+  int pid;
+  struct procstat *st;
+  if(argint(0, &pid) < 0 || argptr(1, (void*)&st, sizeof(*st)) < 0)
+    return -1;
+
+  return getprocstat(pid, st);
+}
+
+int
+sys_set_affinity(void)
+{
+  int pid, mask;
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+
+  return set_affinity(pid, mask);
+}
+
+int
+sys_set_balance(void)
+{
+  int interval, hot;
+  if(argint(0, &interval) < 0 || argint(1, &hot) < 0)
+    return -1;
+
+  return set_balance(interval, hot);
+}
+
+int
+sys_set_nice(void)
+{
+  int pid, nice;
+  if(argint(0, &pid) < 0 || argint(1, &nice) < 0)
+    return -1;
+
+  return set_nice(pid, nice);
+}
+
+int
+sys_set_realtime(void)
+{
+  int pid, period, runtime, deadline;
+  if(argint(0, &pid) < 0 || argint(1, &period) < 0 ||
+     argint(2, &runtime) < 0 || argint(3, &deadline) < 0)
+    return -1;
+
+  return set_realtime(pid, period, runtime, deadline);
+}
+
+int
+sys_yield_to(void)
+{
+  int pid;
+  if(argint(0, &pid) < 0)
+    return -1;
+
+  return yield_to(pid);
+}
+
+int
+sys_sem_tryacquire(void)
+{
+  int i;
+  if(argint(0, &i) < 0)
+    return -1;
+
+  return sem_tryacquire(i);
+}
+
+int
+sys_sem_free(void)
+{
+  int i;
+  if(argint(0, &i) < 0)
+    return -1;
+
+  return sem_free(i);
+}
+
+int
+sys_futex(void)
+{
+  int addr, op, val;
+  if(argint(0, &addr) < 0 || argint(1, &op) < 0 || argint(2, &val) < 0)
+    return -1;
+
+  return futex(addr, op, val);
+}
+
+int
+sys_clone(void)
+{
+  int fn, arg, stack;
+  if(argint(0, &fn) < 0 || argint(1, &arg) < 0 || argint(2, &stack) < 0)
+    return -1;
+
+  return clone(fn, arg, stack);
+}
+
+int
+sys_join(void)
+{
+  uint *stack;
+  if(argptr(0, (void*)&stack, sizeof(*stack)) < 0)
+    return -1;
+
+  return join(stack);
+}
+
+int
+sys_lockstress(void)
+{
+  int kind, end;
+  struct lockstress *ls;
+  if(argint(0, &kind) < 0 || argint(1, &end) < 0 ||
+     argptr(2, (void*)&ls, sizeof(*ls)) < 0)
+    return -1;
+
+  return lockstress(kind, end, ls);
+}
+
+int
+sys_getlockstat(void)
+{
+  struct lockstat *st;
+  int n, reset;
+  if(argint(1, &n) < 0 || n < 0 || argint(2, &reset) < 0)
+    return -1;
+  if(n > NLOCKSTAT)
+    n = NLOCKSTAT;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+
+  return getlockstat(st, n, reset);
+}
@@ -0,0 +1,126 @@
+// Thread creation benchmark.
+// Usage: threadbench [n] [kb]
+// Times n rounds of fork() and wait() for a child that exits at
+// once, with kb kilobytes of heap that fork() has to copy, and then
+// n rounds of clone() and join(), which copy nothing.  Last, a few
+// threads bump a counter under a mutex to check that they really
+// share memory.
+
+#include "types.h"
+#include "stat.h"
+#include "param.h"
+#include "user.h"
+
+#define NTHREAD 4
+#define NBUMP 10000
+
+struct mutex lock;
+uint counter;
+
+void
+quit(void *arg)
+{
+  exit();
+}
+
+void
+bump(void *arg)
+{
+  int i;
+
+  for(i = 0; i < NBUMP; i++){
+    mutex_lock(&lock);
+    counter++;
+    mutex_unlock(&lock);
+  }
+}
+
+void
+report(char *what, int n, uint t)
+{
+  printf(1, "%s: %d in %d ticks", what, n, t);
+  if(t > 0)
+    printf(1, ", %d/sec, %d us each", persec(n, t), t * (1000000 / HZ) / n);
+  printf(1, "\n");
+}
+
+uint
+forks(int n)
+{
+  uint t0;
+  int i, pid;
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    if((pid = fork()) == 0)
+      exit();
+    if(pid < 0){
+      printf(2, "threadbench: fork failed\n");
+      exit();
+    }
+    wait();
+  }
+  return uptime() - t0;
+}
+
+uint
+clones(int n)
+{
+  void *stack, *s;
+  uint t0;
+  int i;
+
+  if((stack = malloc(4096)) == 0){
+    printf(2, "threadbench: out of memory\n");
+    exit();
+  }
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    if(clone(quit, 0, stack) < 0){
+      printf(2, "threadbench: clone failed\n");
+      exit();
+    }
+    join(&s);
+  }
+  t0 = uptime() - t0;
+  free(stack);
+  return t0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n, kb, i;
+  char *heap;
+
+  n = argnum(argc, argv, 1, 1000);
+  kb = argnum(argc, argv, 2, 256);
+  if(n < 1 || kb < 0){
+    printf(2, "usage: threadbench [n] [kb]\n");
+    exit();
+  }
+
+  // Touch the heap so that it is all really there to copy.
+  if((heap = sbrk(kb * 1024)) == (char*)-1){
+    printf(2, "threadbench: sbrk failed\n");
+    exit();
+  }
+  for(i = 0; i < kb * 1024; i += 4096)
+    heap[i] = 1;
+
+  printf(1, "%d creations, %d KB heap\n", n, kb);
+  report("fork+wait ", n, forks(n));
+  report("clone+join", n, clones(n));
+
+  mutex_init(&lock);
+  for(i = 0; i < NTHREAD; i++)
+    if(thread_create(bump, 0) < 0){
+      printf(2, "threadbench: thread_create failed\n");
+      exit();
+    }
+  for(i = 0; i < NTHREAD; i++)
+    thread_join();
+  printf(1, "%d threads bumped the counter to %d (want %d)\n",
+         NTHREAD, counter, NTHREAD * NBUMP);
+  exit();
+}
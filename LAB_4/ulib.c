@@ -3,6 +3,7 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "futex.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -104,3 +105,110 @@ memmove(void *vdst, const void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+//PAGEBREAK!
+// Mutexes, condition variables and barriers.
+// Each keeps its state in a word changed with atomic instructions,
+// and calls futex() only to sleep on the word or to wake someone
+// sleeping on it.  The mutex is the three-state one from Drepper's
+// "Futexes Are Tricky": unlocking a mutex nobody waits for is one
+// atomic add, and locking a free one is one compare-and-swap.
+
+#define WAKE_ALL 0x7fffffff
+
+void
+mutex_init(struct mutex *m)
+{
+  m->state = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  uint c;
+
+  if((c = cmpxchg(&m->state, 0, 1)) == 0)
+    return;
+  // Say there may be waiters before sleeping, so that
+  // the holder knows to wake someone.
+  if(c != 2)
+    c = xchg(&m->state, 2);
+  while(c != 0){
+    futex(&m->state, FUTEX_WAIT, 2);
+    c = xchg(&m->state, 2);
+  }
+}
+
+// Returns 0 if it took m, -1 if m was held.
+int
+mutex_trylock(struct mutex *m)
+{
+  return cmpxchg(&m->state, 0, 1) == 0 ? 0 : -1;
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(xadd(&m->state, -1) != 1){
+    m->state = 0;
+    futex(&m->state, FUTEX_WAKE, 1);
+  }
+}
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+// A signal between reading seq and sleeping changes seq,
+// so futex() returns at once instead of missing it.
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  uint seq = c->seq;
+
+  mutex_unlock(m);
+  futex(&c->seq, FUTEX_WAIT, seq);
+  // Others may be waiting for m too.
+  while(xchg(&m->state, 2) != 0)
+    futex(&m->state, FUTEX_WAIT, 2);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  xadd(&c->seq, 1);
+  futex(&c->seq, FUTEX_WAKE, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  xadd(&c->seq, 1);
+  futex(&c->seq, FUTEX_WAKE, WAKE_ALL);
+}
+
+void
+barrier_init(struct barrier *b, uint n)
+{
+  b->n = n;
+  b->count = 0;
+  b->gen = 0;
+}
+
+// The last to arrive opens the barrier for the others.
+void
+barrier_wait(struct barrier *b)
+{
+  uint gen = b->gen;
+
+  if(xadd(&b->count, 1) == b->n - 1){
+    b->count = 0;
+    xadd(&b->gen, 1);
+    futex(&b->gen, FUTEX_WAKE, WAKE_ALL);
+    return;
+  }
+  while(b->gen == gen)
+    futex(&b->gen, FUTEX_WAIT, gen);
+}
@@ -1,5 +1,10 @@
 struct stat;
 struct rtcdate;
+struct schedstat;
+struct chanstat;
+struct procstat;
+struct lockstress;
+struct lockstat;
 
 // system calls
 int fork(void);
@@ -32,9 +37,29 @@ int lottery_ticket(int, int);
 int BJF_parameter_process(int, int, int, int);
 int BJF_parameter_kernel(int, int, int);
 int print_information(void);
-int sem_init(int, int);
+int sem_init(int);
 int sem_acquire(int);
 int sem_release(int);
+int getschedstat(struct schedstat*);
+int lottery_seed(int);
+int set_lottery_mode(int);
+int set_aging(int);
+int getchanstat(struct chanstat*, int);
+int set_maxproc(int);
+int set_quantum(int, int);
+int getprocstat(int, struct procstat*);
+int set_affinity(int, int);
+int set_balance(int, int);
+int set_nice(int, int);
+int set_realtime(int, int, int, int);
+int yield_to(int);
+int sem_tryacquire(int);
+int sem_free(int);
+int futex(volatile uint*, int, int);
+int clone(void(*)(void*), void*, void*);
+int join(void**);
+int lockstress(int, uint, struct lockstress*);
+int getlockstat(struct lockstat*, int, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -49,3 +74,41 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+
+// ulib.c synchronization, for processes sharing memory.
+// The uncontended paths never enter the kernel.
+struct mutex {
+  volatile uint state;   // 0 free, 1 held, 2 held and maybe waited for
+};
+
+struct cond {
+  volatile uint seq;     // Bumped by every signal
+};
+
+struct barrier {
+  uint n;                // Processes to wait for
+  volatile uint count;   // Arrived so far
+  volatile uint gen;     // Times the barrier has opened
+};
+
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+int mutex_trylock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
+void barrier_init(struct barrier*, uint);
+void barrier_wait(struct barrier*);
+
+// uthread.c
+int thread_create(void(*)(void*), void*);
+int thread_join(void);
+
+// bench.c
+void burn(void) __attribute__((noreturn));
+int hog(void);
+void killwait(int*, int);
+int argnum(int, char*[], int, int);
+uint persec(uint, uint);
@@ -0,0 +1,51 @@
+// Threads on clone() and join(), with stacks from malloc().
+
+#include "types.h"
+#include "user.h"
+
+#define TSTACK 4096   // clone() wants a page of stack
+
+// Kept at the bottom of a thread's stack.
+struct tstart {
+  void (*fn)(void*);
+  void *arg;
+};
+
+static void
+thread_start(void *a)
+{
+  struct tstart *t = a;
+
+  t->fn(t->arg);
+  exit();
+}
+
+// Run fn(arg) in a new thread, which exits when fn returns.
+// Threads share malloc()'s free list, so only one of them
+// should create and join the others.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  struct tstart *t;
+  int pid;
+
+  if((t = malloc(TSTACK)) == 0)
+    return -1;
+  t->fn = fn;
+  t->arg = arg;
+  if((pid = clone(thread_start, t, t)) < 0)
+    free(t);
+  return pid;
+}
+
+// Reap a thread made by thread_create() and free its stack.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(stack);
+  return pid;
+}